@@ -9,6 +9,22 @@
 #include <string.h>
 #include <inttypes.h>
 
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TS_ALIGNMENT_SSE2
+#include <emmintrin.h>
+#ifdef TSD_PLATFORM_MSVC
+#include <intrin.h>
+static inline int tsd_ctz(unsigned int x)
+{
+	unsigned long i;
+	_BitScanForward(&i, x);
+	return (int)i;
+}
+#else
+#define tsd_ctz(x)		__builtin_ctz(x)
+#endif
+#endif
+
 #include "utils/arib_proginfo.h"
 #include "core/module_api.h"
 #include "utils/arib_parser.h"
@@ -56,62 +72,274 @@ void ts_packet_counter(ts_header_t *tsh)
 
 void create_ts_alignment_filter(ts_alignment_filter_t *filter)
 {
-	filter->buf_size = 188 * 1024;
-	filter->buf = (uint8_t*)malloc(filter->buf_size);
+	filter->buf_size = 0;
+	filter->buf = NULL;
+	filter->runs_size = 0;
+	filter->runs = NULL;
+	reset_ts_alignment_filter(filter);
+}
+
+void delete_ts_alignment_filter(ts_alignment_filter_t *filter)
+{
+	free(filter->buf);
+	free(filter->runs);
+}
+
+/* V[NȂǂŁAzf[^ƓԂ̂Ă */
+void reset_ts_alignment_filter(ts_alignment_filter_t *filter)
+{
 	filter->remain = 0;
 	filter->bytes = 0;
 	filter->skip = 0;
+	filter->locked = 0;
+	filter->packet_size = 188;
+	filter->header_offset = 0;
+	filter->dropped = 0;
+	filter->n_runs = 0;
 }
 
-void delete_ts_alignment_filter(ts_alignment_filter_t *filter)
+/* pPbg̑傫B188oCgD悷 */
+static const int packet_sizes[] = { 188, 192, 204 };
+
+/* zƍ̓͂ȂƂvoCg */
+#define VBYTE(v)	((v) < carry_n ? filter->carry[v] : in_buf[(v) - carry_n])
+
+/* vsizeoCgTS_ALIGNMENT_LOCK_SYNCS̓oCgł邩B͂̏Iłbytes܂ł̕ */
+static inline int is_sync_lock(const ts_alignment_filter_t *filter, const uint8_t *in_buf, int carry_n, int v, int size, int bytes)
 {
-	free(filter->buf);
+	int i;
+	for (i = 1; i < TS_ALIGNMENT_LOCK_SYNCS && v + i * size < bytes; i++) {
+		if (VBYTE(v + i * size) != 0x47) {
+			return 0;
+		}
+	}
+	return 1;
 }
 
-void ts_alignment_filter(ts_alignment_filter_t *filter, uint8_t **out_buf, int *out_bytes, const uint8_t *in_buf, int in_bytes)
+/* oCgv瓯΃pPbg̑傫߂āApPbg̐擪ԂBȂ-1 */
+static int try_lock(ts_alignment_filter_t *filter, const uint8_t *in_buf, int carry_n, int v, int pos, int bytes)
 {
-	uint8_t tmp[188];
-	int bytes, skip, sync, skip_tmp, sync_tmp;
+	int i, size, offset, start;
 
-	bytes = filter->remain + in_bytes;
-	if (bytes > filter->buf_size) {
-		if (filter->remain > 0) {
-			memcpy(tmp, &filter->buf[filter->bytes - filter->remain], filter->remain);
+	for (i = 0; i < (int)(sizeof(packet_sizes) / sizeof(packet_sizes[0])); i++) {
+		size = packet_sizes[i];
+		if (!is_sync_lock(filter, in_buf, carry_n, v, size, bytes)) {
+			continue;
 		}
-		free(filter->buf);
-		while (bytes > filter->buf_size) {
-			filter->buf_size *= 2;
+		offset = (size == 192) ? 4 : 0;
+		start = v - offset;
+		if (start < pos) {
+			/* ^CX^vĂ̂Ŏ̃pPbg */
+			start += size;
 		}
-		filter->buf = (uint8_t*)malloc(filter->buf_size);
-		if (filter->remain > 0) {
-			memcpy(filter->buf, tmp, filter->remain);
+		if (start + size > bytes) {
+			/* ͂̏IŁApPbg1܂Ȃ */
+			continue;
 		}
-	} else if (filter->remain > 0) {
-		memmove(filter->buf, &filter->buf[filter->bytes - filter->remain], filter->remain);
+		filter->packet_size = size;
+		filter->header_offset = offset;
+		return start;
 	}
-	memcpy(&filter->buf[filter->remain], in_buf, in_bytes);
+	return -1;
+}
 
-	/* ő4sync܂ŁAősyncskip */
-	sync = 0;
-	skip = 0;
-	for (skip_tmp = 0; skip_tmp < 188; skip_tmp++) {
-		for (sync_tmp = 0; sync_tmp < 4 && sync_tmp*188+skip_tmp < bytes; sync_tmp++) {
-			if (filter->buf[sync_tmp * 188 + skip_tmp] != 0x47) {
+/* [v, end)瓯ʒuTB͂̕ł͓oCǧ16oCg܂Ƃ߂ĒT */
+static int find_sync(ts_alignment_filter_t *filter, const uint8_t *in_buf, int carry_n, int v, int end, int bytes)
+{
+	int pos = v, start;
+#ifdef TS_ALIGNMENT_SSE2
+	unsigned int bits;
+	const __m128i sync = _mm_set1_epi8(0x47);
+#endif
+
+	for (; v < end && v < carry_n; v++) {
+		if (filter->carry[v] == 0x47 && (start = try_lock(filter, in_buf, carry_n, v, pos, bytes)) >= 0) {
+			return start;
+		}
+	}
+#ifdef TS_ALIGNMENT_SSE2
+	for (; v + 16 <= end; v += 16) {
+		bits = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)&in_buf[v - carry_n]), sync));
+		while (bits) {
+			if ((start = try_lock(filter, in_buf, carry_n, v + tsd_ctz(bits), pos, bytes)) >= 0) {
+				return start;
+			}
+			bits &= bits - 1;
+		}
+	}
+#endif
+	for (; v < end; v++) {
+		if (in_buf[v - carry_n] == 0x47 && (start = try_lock(filter, in_buf, carry_n, v, pos, bytes)) >= 0) {
+			return start;
+		}
+	}
+	return -1;
+}
+
+/* O̕тƃł͏łAĂ΂Ȃ */
+static void add_run(ts_alignment_filter_t *filter, const uint8_t *data, int pos, int bytes)
+{
+	ts_alignment_run_t *run;
+
+	if (bytes <= 0) {
+		return;
+	}
+	if (filter->n_runs > 0) {
+		run = &filter->runs[filter->n_runs - 1];
+		if (run->data + run->bytes == data && run->pos + run->bytes == pos && run->packet_size == filter->packet_size) {
+			run->bytes += bytes;
+			return;
+		}
+	}
+	run = &filter->runs[filter->n_runs++];
+	run->data = data;
+	run->pos = pos;
+	run->bytes = bytes;
+	run->packet_size = filter->packet_size;
+	run->header_offset = filter->header_offset;
+}
+
+/*
+	͂pPbgɐ񂵂filter->runsɕԂBpPbg̑傫(188/192/204)͓ƂɔʂB
+	͂̓Rs[ɂ̂܂܎wAO񂩂玝z[ɂpPbgstitchłȂ킹B
+	runs͎ɌĂԂ܂ŗLB
+	̓ubN܂ŕێAOꂽubN̓rłTBOꂽƂ݂Ȃ̂́A
+	oCgĂĂ̌2pPbgoCgĂȂꍇŁA1oCǧł͊OȂB
+	final͓͂̏IŁA̓oCgȂĂ͂ɎcĂ镪ĂΓ
+*/
+static void alignment_runs(ts_alignment_filter_t *filter, const uint8_t *in_buf, int in_bytes, int final)
+{
+	int bytes, pos, start, n, size, sync, carry_n = filter->remain, n_stitch = 0;
+	uint8_t *dst;
+
+	bytes = carry_n + in_bytes;
+	/* т̐̓pPbg+1zȂ */
+	if (filter->runs_size < bytes / 188 + 2) {
+		filter->runs_size = bytes / 188 + 2;
+		free(filter->runs);
+		filter->runs = (ts_alignment_run_t*)malloc(sizeof(ts_alignment_run_t) * filter->runs_size);
+	}
+
+	filter->n_runs = 0;
+	filter->dropped = 0;
+	pos = 0;
+	while (1) {
+		if (!filter->locked) {
+			/* ̓oCgĂȂʒu͎̓͂ƍ킹Ēׂ */
+			start = find_sync(filter, in_buf, carry_n, pos, final ? bytes : bytes - TS_ALIGNMENT_LOOKAHEAD, bytes);
+			if (start < 0) {
+				start = final ? bytes : bytes - TS_ALIGNMENT_MAX_REMAIN;
+				if (start < pos) {
+					start = pos;
+				}
+				filter->dropped += start - pos;
+				pos = start;
 				break;
 			}
+			filter->dropped += start - pos;
+			pos = start;
+			filter->locked = 1;
+		}
+
+		size = filter->packet_size;
+		sync = filter->header_offset;
+		start = pos;
+		while (pos + size <= bytes) {
+			if (VBYTE(pos + sync) != 0x47) {
+				if (pos + size * 2 + sync >= bytes) {
+					if (!final) {
+						/* fłȂ̂Ŏ̓͂҂ */
+						break;
+					}
+					/* ͂̏Ił́AcĂ鎟̃pPbg̓oCgŔf */
+					if (pos + size + sync >= bytes || VBYTE(pos + size + sync) != 0x47) {
+						filter->locked = 0;
+						break;
+					}
+				} else if (VBYTE(pos + size + sync) != 0x47 || VBYTE(pos + size * 2 + sync) != 0x47) {
+					filter->locked = 0;
+					break;
+				}
+			}
+			if (pos < carry_n) {
+				/* z[ɂpPbg͂Ȃ킹 */
+				dst = &filter->stitch[n_stitch];
+				n = (carry_n - pos < size) ? carry_n - pos : size;
+				memcpy(dst, &filter->carry[pos], n);
+				memcpy(&dst[n], in_buf, size - n);
+				add_run(filter, dst, pos, size);
+				n_stitch += size;
+				start = pos + size;
+			}
+			pos += size;
 		}
-		if (sync < sync_tmp) {
-			sync = sync_tmp;
-			skip = skip_tmp;
+		if (pos > start) {
+			add_run(filter, &in_buf[start - carry_n], start, pos - start);
 		}
+		if (filter->locked) {
+			break;
+		}
+	}
+
+	if (final) {
+		/* ̔[ȃpPbĝ͎Ă */
+		filter->dropped += bytes - pos;
+		pos = bytes;
+	}
+
+	/* [z */
+	if (pos < carry_n) {
+		memmove(filter->carry, &filter->carry[pos], carry_n - pos);
+		memcpy(&filter->carry[carry_n - pos], in_buf, in_bytes);
+	} else {
+		memcpy(filter->carry, &in_buf[pos - carry_n], bytes - pos);
 	}
 	filter->bytes = bytes;
-	filter->skip = skip;
+	filter->remain = bytes - pos;
+	filter->skip = (filter->n_runs > 0) ? filter->runs[0].pos : pos;
+}
+
+void ts_alignment_filter_runs(ts_alignment_filter_t *filter, const uint8_t *in_buf, int in_bytes)
+{
+	alignment_runs(filter, in_buf, in_bytes, 0);
+}
+
+/* ͂̏IŁAz[ɎcĂpPbgfilter->runsɕԂB
+   ɕKvTS_ALIGNMENT_LOCK_SYNCSɑȂZ͂▖ŏo */
+void ts_alignment_filter_finish(ts_alignment_filter_t *filter)
+{
+	alignment_runs(filter, filter->carry, 0, 1);
+}
+
+#undef VBYTE
 
-	bytes -= skip;
-	*out_bytes = bytes / 188 * 188;
-	*out_buf = &filter->buf[skip];
-	filter->remain = bytes - (*out_bytes);
+/* 񂵂pPbg188oCgTSpPbgɂ1̃obt@ɋl߂ĕԂ */
+void ts_alignment_filter(ts_alignment_filter_t *filter, uint8_t **out_buf, int *out_bytes, const uint8_t *in_buf, int in_bytes)
+{
+	int i, j, n;
+	const ts_alignment_run_t *run;
+
+	ts_alignment_filter_runs(filter, in_buf, in_bytes);
+	if (filter->buf_size < filter->bytes) {
+		free(filter->buf);
+		filter->buf_size = filter->bytes;
+		filter->buf = (uint8_t*)malloc(filter->buf_size);
+	}
+	n = 0;
+	for (i = 0; i < filter->n_runs; i++) {
+		run = &filter->runs[i];
+		if (run->packet_size == 188) {
+			memcpy(&filter->buf[n], run->data, run->bytes);
+			n += run->bytes;
+			continue;
+		}
+		for (j = 0; j < run->bytes; j += run->packet_size) {
+			memcpy(&filter->buf[n], &run->data[j + run->header_offset], 188);
+			n += 188;
+		}
+	}
+	*out_buf = filter->buf;
+	*out_bytes = n;
 }
 
 /* 188oCgACł͂ȂXg[𑗂ĂBonDriveriƂFriiojɑΉ邽߂̃_~[fR[_ */
@@ -126,7 +354,7 @@ void default_decoder(uint8_t **out_buf, int *out_bytes, const uint8_t *in_buf, i
 	}
 
 	ts_alignment_filter(&filter, out_buf, out_bytes, in_buf, in_bytes);
-	if (filter.skip != 0) {
-		output_message(MSG_WARNING, TSD_TEXT("skipped %d bytes"), filter.skip);
+	if (filter.dropped != 0) {
+		output_message(MSG_WARNING, TSD_TEXT("skipped %d bytes"), filter.dropped);
 	}
 }
\ No newline at end of file
@@ -2,11 +2,52 @@ extern int64_t ts_n_drops;
 extern int64_t ts_n_total;
 extern int64_t ts_n_scrambled;
 
+/* ̂ɕKvȘAoCg̐ */
+#define TS_ALIGNMENT_LOCK_SYNCS		4
+/*
+	͂̃pPbg̑傫B192oCg͐擪4oCg̃^CX^vt(M2TS/TTS)A
+	204oCg͖16oCg̃[h\t
+*/
+#define TS_ALIGNMENT_MAX_PACKET		204
+/* oCǧœm߂̂ɕKvȃoCg */
+#define TS_ALIGNMENT_LOOKAHEAD		(TS_ALIGNMENT_MAX_PACKET * (TS_ALIGNMENT_LOCK_SYNCS - 1))
+/* ̌ĂяoɎzoCg̏ */
+#define TS_ALIGNMENT_MAX_REMAIN		(TS_ALIGNMENT_LOOKAHEAD + 4)
+#define TS_ALIGNMENT_STITCH_SIZE	(TS_ALIGNMENT_MAX_PACKET * TS_ALIGNMENT_LOCK_SYNCS)
+
+/*
+	ς݂̃pPbg̕сBdata͓͂̃obt@AubN܂pPbgȂ킹stitchwB
+	pos͎zƍ̓͂ȂƂ̈ʒuŁA͏łAĂB
+	pPbgpacket_sizeoCgɕсATSpPbĝ͂̒header_offsetoCgڂn܂
+*/
+typedef struct
+{
+	const uint8_t *data;
+	int pos;
+	int bytes;
+	int packet_size;
+	int header_offset;
+} ts_alignment_run_t;
+
 typedef struct
 {
+	/* ̌ĂяoɎzoCg */
 	int remain;
 	int skip;
+	/* zƍ̓͂̍v */
 	int bytes;
+	int locked;
+	/* ĂpPbg̑傫 */
+	int packet_size;
+	int header_offset;
+	/* ̓͂Ŏ̂ĂoCg */
+	int dropped;
+	int n_runs;
+	int runs_size;
+	ts_alignment_run_t *runs;
+	uint8_t carry[TS_ALIGNMENT_MAX_REMAIN];
+	uint8_t stitch[TS_ALIGNMENT_STITCH_SIZE];
+	/* ts_alignment_filterŋl߂ĕԂ߂̃obt@ */
 	int buf_size;
 	uint8_t *buf;
 } ts_alignment_filter_t;
@@ -14,5 +55,8 @@ typedef struct
 void ts_packet_counter(ts_header_t *tsh);
 void create_ts_alignment_filter(ts_alignment_filter_t *filter);
 void delete_ts_alignment_filter(ts_alignment_filter_t *filter);
+void reset_ts_alignment_filter(ts_alignment_filter_t *filter);
+void ts_alignment_filter_runs(ts_alignment_filter_t *filter, const uint8_t *in_buf, int in_bytes);
+void ts_alignment_filter_finish(ts_alignment_filter_t *filter);
 void ts_alignment_filter(ts_alignment_filter_t *filter, uint8_t **out_buf, int *out_bytes, const uint8_t *in_buf, int in_bytes);
 void default_decoder(uint8_t **out_buf, int *out_bytes, const uint8_t *in_buf, int in_bytes);
\ No newline at end of file
@@ -0,0 +1,194 @@
+#include "core/tsdump_def.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TS_BATCH_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(TSD_PLATFORM_MSVC)
+#define TS_BATCH_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+#ifdef TSD_PLATFORM_MSVC
+#include <intrin.h>
+#define TS_BATCH_AVX2_FUNC
+#else
+#define TS_BATCH_AVX2_FUNC		__attribute__((target("avx2")))
+#endif
+
+#include "core/ts_batch.h"
+
+/*
+	4oCg̃wb_gGfBA32bitlƂēǂނ
+	bit 0-7 : sync_byte, bit 8-12 : PID̏, bit 14 : payload_unit_start_indicator,
+	bit 16-23 : PID̉, bit 24-27 : CC, bit 28-29 : adaptation_field_control, bit 30-31 : scrambling
+*/
+
+static int use_avx2 = 0;
+
+/* XbhOɌĂ */
+void ts_batch_init()
+{
+#if defined(TS_BATCH_AVX2) && defined(TSD_PLATFORM_MSVC)
+	int info[4];
+	__cpuid(info, 1);
+	/* OSYMMWX^ۑ邩 */
+	if ((info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6) {
+		__cpuidex(info, 7, 0);
+		use_avx2 = !!(info[1] & (1 << 5));
+	}
+#elif defined(TS_BATCH_AVX2)
+	__builtin_cpu_init();
+	use_avx2 = !!__builtin_cpu_supports("avx2");
+#endif
+}
+
+static inline uint32_t load_header(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void batch_scalar(ts_batch_t *b, const uint8_t *pkts, int stride, int i, int n)
+{
+	uint32_t h;
+	const uint8_t *p;
+
+	for (; i < n; i++) {
+		p = &pkts[i * stride];
+		h = load_header(p);
+		b->valid[i] = ((h & 0xff) == 0x47 && !((h >> 28) == 3 && p[4] > 182));
+		b->pid[i] = (uint16_t)((h & 0x1f00) | ((h >> 16) & 0xff));
+		b->payload_unit_start_indicator[i] = (h >> 14) & 1;
+		b->transport_scrambling_control[i] = (uint8_t)(h >> 30);
+		b->adaptation_field_control[i] = (h >> 28) & 3;
+		b->continuity_counter[i] = (h >> 24) & 15;
+	}
+}
+
+#ifdef TS_BATCH_SSE2
+
+static inline void store4_u8(uint8_t *dst, __m128i v)
+{
+	int t;
+	v = _mm_packs_epi32(v, v);
+	v = _mm_packus_epi16(v, v);
+	t = _mm_cvtsi128_si32(v);
+	memcpy(dst, &t, 4);
+}
+
+/* 4pPbg */
+static int batch_sse2(ts_batch_t *b, const uint8_t *pkts, int stride, int i, int n)
+{
+	uint32_t h[4], a[4];
+	const uint8_t *p;
+	__m128i hdr, af, low, bad;
+	const __m128i mask8 = _mm_set1_epi32(0xff);
+	const __m128i one = _mm_set1_epi32(1);
+
+	for (; i + 4 <= n; i += 4) {
+		p = &pkts[i * stride];
+		memcpy(&h[0], &p[0], 4);
+		memcpy(&h[1], &p[stride], 4);
+		memcpy(&h[2], &p[stride * 2], 4);
+		memcpy(&h[3], &p[stride * 3], 4);
+		a[0] = p[4];
+		a[1] = p[stride + 4];
+		a[2] = p[stride * 2 + 4];
+		a[3] = p[stride * 3 + 4];
+		hdr = _mm_loadu_si128((const __m128i*)h);
+		af = _mm_loadu_si128((const __m128i*)a);
+
+		/* XNuŃA_ve[VtB[hƃyC[hAyC[ḧʒu188z */
+		bad = _mm_and_si128(_mm_cmpeq_epi32(_mm_srli_epi32(hdr, 28), _mm_set1_epi32(3)),
+			_mm_cmpgt_epi32(af, _mm_set1_epi32(182)));
+		low = _mm_cmpeq_epi32(_mm_and_si128(hdr, mask8), _mm_set1_epi32(0x47));
+		store4_u8(&b->valid[i], _mm_and_si128(_mm_andnot_si128(bad, low), one));
+
+		low = _mm_or_si128(_mm_and_si128(hdr, _mm_set1_epi32(0x1f00)), _mm_and_si128(_mm_srli_epi32(hdr, 16), mask8));
+		low = _mm_packs_epi32(low, low);
+		_mm_storel_epi64((__m128i*)&b->pid[i], low);
+
+		store4_u8(&b->payload_unit_start_indicator[i], _mm_and_si128(_mm_srli_epi32(hdr, 14), one));
+		store4_u8(&b->transport_scrambling_control[i], _mm_srli_epi32(hdr, 30));
+		store4_u8(&b->adaptation_field_control[i], _mm_and_si128(_mm_srli_epi32(hdr, 28), _mm_set1_epi32(3)));
+		store4_u8(&b->continuity_counter[i], _mm_and_si128(_mm_srli_epi32(hdr, 24), _mm_set1_epi32(15)));
+	}
+	return i;
+}
+
+#endif
+
+#ifdef TS_BATCH_AVX2
+
+static inline TS_BATCH_AVX2_FUNC __m128i pack8_u16(__m256i v)
+{
+	/* 128bit[ƂɃpbN̂ŁA㉺̃[̑OȂ */
+	v = _mm256_packus_epi32(v, v);
+	v = _mm256_permute4x64_epi64(v, 0x08);
+	return _mm256_castsi256_si128(v);
+}
+
+static inline TS_BATCH_AVX2_FUNC void store8_u8(uint8_t *dst, __m256i v)
+{
+	__m128i w = pack8_u16(v);
+	_mm_storel_epi64((__m128i*)dst, _mm_packus_epi16(w, w));
+}
+
+/* 8pPbgMU[œǂ */
+static TS_BATCH_AVX2_FUNC int batch_avx2(ts_batch_t *b, const uint8_t *pkts, int stride, int n)
+{
+	int i;
+	const uint8_t *p;
+	__m256i hdr, af, low, bad;
+	const __m256i index = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stride));
+	const __m256i mask8 = _mm256_set1_epi32(0xff);
+	const __m256i one = _mm256_set1_epi32(1);
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		p = &pkts[i * stride];
+		hdr = _mm256_i32gather_epi32((const int*)p, index, 1);
+		af = _mm256_and_si256(_mm256_i32gather_epi32((const int*)&p[4], index, 1), mask8);
+
+		bad = _mm256_and_si256(_mm256_cmpeq_epi32(_mm256_srli_epi32(hdr, 28), _mm256_set1_epi32(3)),
+			_mm256_cmpgt_epi32(af, _mm256_set1_epi32(182)));
+		low = _mm256_cmpeq_epi32(_mm256_and_si256(hdr, mask8), _mm256_set1_epi32(0x47));
+		store8_u8(&b->valid[i], _mm256_and_si256(_mm256_andnot_si256(bad, low), one));
+
+		low = _mm256_or_si256(_mm256_and_si256(hdr, _mm256_set1_epi32(0x1f00)), _mm256_and_si256(_mm256_srli_epi32(hdr, 16), mask8));
+		_mm_storeu_si128((__m128i*)&b->pid[i], pack8_u16(low));
+
+		store8_u8(&b->payload_unit_start_indicator[i], _mm256_and_si256(_mm256_srli_epi32(hdr, 14), one));
+		store8_u8(&b->transport_scrambling_control[i], _mm256_srli_epi32(hdr, 30));
+		store8_u8(&b->adaptation_field_control[i], _mm256_and_si256(_mm256_srli_epi32(hdr, 28), _mm256_set1_epi32(3)));
+		store8_u8(&b->continuity_counter[i], _mm256_and_si256(_mm256_srli_epi32(hdr, 24), _mm256_set1_epi32(15)));
+	}
+	return i;
+}
+
+#endif
+
+/* pktsstrideoCgɕԍőTS_BATCH_SIZE̃pPbg̃wb_fR[hāAfR[hԂ */
+int ts_batch_headers(ts_batch_t *b, const uint8_t *pkts, int stride, int n)
+{
+	int i = 0;
+
+	if (n > TS_BATCH_SIZE) {
+		n = TS_BATCH_SIZE;
+	}
+#ifdef TS_BATCH_AVX2
+	if (use_avx2) {
+		i = batch_avx2(b, pkts, stride, n);
+	}
+#endif
+#ifdef TS_BATCH_SSE2
+	i = batch_sse2(b, pkts, stride, i, n);
+#endif
+	batch_scalar(b, pkts, stride, i, n);
+	b->n = n;
+	return n;
+}
@@ -0,0 +1,18 @@
+#define TS_BATCH_SIZE				256
+
+/*
+	ubÑpPbg̃wb_܂Ƃ߂ăfR[h (SoA)
+	valid : oCgAA_ve[VtB[h͈͓
+*/
+typedef struct {
+	int n;
+	uint8_t valid[TS_BATCH_SIZE];
+	uint16_t pid[TS_BATCH_SIZE];
+	uint8_t payload_unit_start_indicator[TS_BATCH_SIZE];
+	uint8_t transport_scrambling_control[TS_BATCH_SIZE];
+	uint8_t adaptation_field_control[TS_BATCH_SIZE];
+	uint8_t continuity_counter[TS_BATCH_SIZE];
+} ts_batch_t;
+
+void ts_batch_init();
+int ts_batch_headers(ts_batch_t *b, const uint8_t *pkts, int stride, int n);
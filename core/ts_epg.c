@@ -0,0 +1,464 @@
+#include "core/tsdump_def.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "utils/arib_proginfo.h"
+#include "utils/arib_parser.h"
+#include "utils/tsdcrc.h"
+#include "core/ts_epg.h"
+
+/*
+	EIT̃ZNV͎󂯎܂܂̌`ŃTue[u(T[rXtable_id̑g)ƂɎA
+	ԑg͎̍QƂꂽƂɍB
+	o[WςTue[u͌ÂZNV̂ĂĂVZNV󂯕tB
+	p/f(0x4E, 0x4F)ƃXPW[̗ɓԑgƂp/fD悷
+*/
+
+#define EPG_MIN_TABLE_ID		0x4e
+#define EPG_MAX_TABLE_ID		0x6f
+#define EPG_N_TABLES			(EPG_MAX_TABLE_ID - EPG_MIN_TABLE_ID + 1)
+#define EPG_MAX_SECTION			4096
+#define EPG_HEADER_SIZE			14
+#define EPG_EVENT_SIZE			12
+#define EPG_N_PIDS				3
+#define EPG_HASH_SIZE			256
+
+/* PIDƂ̃ZNV̑gݗāB1̃pPbgɕ̃ZNVl߂ĂĂ悢 */
+typedef struct {
+	int pid;
+	int cc;
+	int len;
+	int recv;
+	uint8_t buf[EPG_MAX_SECTION];
+} epg_assembler_t;
+
+typedef struct {
+	int version;
+	uint8_t *sections[256];
+	int lens[256];
+	uint32_t crc[256];
+} epg_table_t;
+
+typedef struct {
+	int original_network_id;
+	int transport_stream_id;
+	int service_id;
+	/* nbVl̎̃T[rXB-1 */
+	int next;
+	epg_table_t *tables[EPG_N_TABLES];
+	/* ZNVς蒼 */
+	int dirty;
+	int n_events;
+	int max_events;
+	ts_epg_event_t *events;		/* Jn */
+	ts_epg_event_t **by_id;		/* event_id */
+} epg_service_t;
+
+struct ts_epg_s {
+	epg_assembler_t asms[EPG_N_PIDS];
+	int n_services;
+	int max_services;
+	epg_service_t *services;
+	int hash[EPG_HASH_SIZE];
+};
+
+static inline int bcd2(unsigned int v)
+{
+	return (v >> 4 & 0x0f) * 10 + (v & 0x0f);
+}
+
+ts_epg_t *ts_epg_create()
+{
+	int i;
+	static const int pids[EPG_N_PIDS] = { 0x12, 0x26, 0x27 };
+	ts_epg_t *epg;
+
+	epg = (ts_epg_t*)malloc(sizeof(ts_epg_t));
+	if (!epg) {
+		return NULL;
+	}
+	for (i = 0; i < EPG_N_PIDS; i++) {
+		epg->asms[i].pid = pids[i];
+		epg->asms[i].cc = -1;
+		epg->asms[i].recv = 0;
+	}
+	epg->n_services = epg->max_services = 0;
+	epg->services = NULL;
+	memset(epg->hash, 0xff, sizeof(epg->hash));
+	return epg;
+}
+
+static epg_service_t *find_service(const ts_epg_t *epg, int original_network_id, int service_id)
+{
+	int i;
+	epg_service_t *s;
+	for (i = epg->hash[service_id % EPG_HASH_SIZE]; i >= 0; i = s->next) {
+		s = &epg->services[i];
+		if (s->service_id == service_id && s->original_network_id == original_network_id) {
+			return s;
+		}
+	}
+	return NULL;
+}
+
+static epg_service_t *add_service(ts_epg_t *epg, int original_network_id, int service_id)
+{
+	int h = service_id % EPG_HASH_SIZE;
+	epg_service_t *s;
+
+	if (epg->n_services >= epg->max_services) {
+		s = (epg_service_t*)realloc(epg->services, sizeof(epg_service_t) * (epg->max_services + 16));
+		if (!s) {
+			return NULL;
+		}
+		epg->services = s;
+		epg->max_services += 16;
+	}
+	s = &epg->services[epg->n_services];
+	memset(s, 0, sizeof(epg_service_t));
+	s->original_network_id = original_network_id;
+	s->service_id = service_id;
+	s->next = epg->hash[h];
+	epg->hash[h] = epg->n_services++;
+	return s;
+}
+
+static void store_section(ts_epg_t *epg, const uint8_t *sec, int len)
+{
+	int i, table_id = sec[0], version, section_number, original_network_id, service_id;
+	uint32_t crc;
+	uint8_t *p;
+	epg_service_t *s;
+	epg_table_t *t;
+
+	if (table_id < EPG_MIN_TABLE_ID || table_id > EPG_MAX_TABLE_ID || len < EPG_HEADER_SIZE + 4) {
+		return;
+	}
+	if (!(sec[5] & 0x01)) {
+		/* current_next_indicator */
+		return;
+	}
+	crc = (uint32_t)sec[len - 4] << 24 | (uint32_t)sec[len - 3] << 16 | (uint32_t)sec[len - 2] << 8 | sec[len - 1];
+	if (tsd_crc32(sec, len - 4) != crc) {
+		return;
+	}
+
+	service_id = sec[3] << 8 | sec[4];
+	version = sec[5] >> 1 & 0x1f;
+	section_number = sec[6];
+	original_network_id = sec[10] << 8 | sec[11];
+
+	s = find_service(epg, original_network_id, service_id);
+	if (!s) {
+		s = add_service(epg, original_network_id, service_id);
+		if (!s) {
+			return;
+		}
+	}
+	s->transport_stream_id = sec[8] << 8 | sec[9];
+
+	t = s->tables[table_id - EPG_MIN_TABLE_ID];
+	if (!t) {
+		t = (epg_table_t*)calloc(1, sizeof(epg_table_t));
+		if (!t) {
+			return;
+		}
+		t->version = -1;
+		s->tables[table_id - EPG_MIN_TABLE_ID] = t;
+	}
+	if (t->version != version) {
+		for (i = 0; i < 256; i++) {
+			free(t->sections[i]);
+			t->sections[i] = NULL;
+		}
+		t->version = version;
+		s->dirty = 1;
+	}
+	if (t->sections[section_number] && t->crc[section_number] == crc) {
+		/* đ */
+		return;
+	}
+
+	p = (uint8_t*)realloc(t->sections[section_number], len);
+	if (!p) {
+		return;
+	}
+	memcpy(p, sec, len);
+	t->sections[section_number] = p;
+	t->lens[section_number] = len;
+	t->crc[section_number] = crc;
+	s->dirty = 1;
+}
+
+/* pnoCggݗĒ̃ZNVɑāAgoCgԂ */
+static int feed_section(ts_epg_t *epg, epg_assembler_t *a, const uint8_t *p, int n)
+{
+	int len, used = 0;
+
+	if (a->recv < 3) {
+		used = 3 - a->recv < n ? 3 - a->recv : n;
+		memcpy(&a->buf[a->recv], p, used);
+		a->recv += used;
+		if (a->recv < 3) {
+			return used;
+		}
+		a->len = 3 + ((a->buf[1] & 0x0f) << 8 | a->buf[2]);
+		if (a->len > EPG_MAX_SECTION) {
+			a->recv = 0;
+			return n;
+		}
+	}
+
+	len = a->len - a->recv;
+	if (len > n - used) {
+		len = n - used;
+	}
+	memcpy(&a->buf[a->recv], &p[used], len);
+	a->recv += len;
+	used += len;
+	if (a->recv == a->len) {
+		store_section(epg, a->buf, a->len);
+		a->recv = 0;
+	}
+	return used;
+}
+
+void ts_epg_packet(ts_epg_t *epg, const uint8_t *packet, const ts_header_t *tsh)
+{
+	int i, pos, pointer_field;
+	epg_assembler_t *a = NULL;
+
+	for (i = 0; i < EPG_N_PIDS; i++) {
+		if (epg->asms[i].pid == (int)tsh->pid) {
+			a = &epg->asms[i];
+		}
+	}
+	if (!a || tsh->transport_scrambling_control || !(tsh->adaptation_field_control & 0x01)) {
+		return;
+	}
+
+	if (a->cc >= 0 && (a->cc + 1) % 16 != (int)tsh->continuity_counter) {
+		if (a->cc == (int)tsh->continuity_counter) {
+			/* dpPbg */
+			return;
+		}
+		/* r؂ꂽgݗĒ̃ZNV͎̂Ă */
+		a->recv = 0;
+	}
+	a->cc = tsh->continuity_counter;
+
+	pos = tsh->payload_pos;
+	if (!tsh->payload_unit_start_indicator) {
+		if (a->recv > 0) {
+			feed_section(epg, a, &packet[pos], 188 - pos);
+		}
+		return;
+	}
+
+	pointer_field = packet[pos++];
+	if (pos + pointer_field >= 188) {
+		a->recv = 0;
+		return;
+	}
+	if (a->recv > 0) {
+		/* ÕpPbg瑱ZNV̎c */
+		feed_section(epg, a, &packet[pos], pointer_field);
+		a->recv = 0;
+	}
+	pos += pointer_field;
+	while (pos < 188 && packet[pos] != 0xff) {
+		pos += feed_section(epg, a, &packet[pos], 188 - pos);
+	}
+}
+
+static int cmp_start(const void *p1, const void *p2)
+{
+	const ts_epg_event_t *e1 = (const ts_epg_event_t*)p1, *e2 = (const ts_epg_event_t*)p2;
+	int t1, t2;
+
+	/* Jn̔ԑg͍Ō */
+	if (e1->unknown_start != e2->unknown_start) {
+		return e1->unknown_start - e2->unknown_start;
+	}
+	if (e1->start.mjd != e2->start.mjd) {
+		return (int)e1->start.mjd - (int)e2->start.mjd;
+	}
+	t1 = (e1->start.hour * 60 + e1->start.min) * 60 + e1->start.sec;
+	t2 = (e2->start.hour * 60 + e2->start.min) * 60 + e2->start.sec;
+	if (t1 != t2) {
+		return t1 - t2;
+	}
+	return e1->event_id - e2->event_id;
+}
+
+static int cmp_id(const void *p1, const void *p2)
+{
+	const ts_epg_event_t *e1 = *(const ts_epg_event_t**)p1, *e2 = *(const ts_epg_event_t**)p2;
+	return e1->event_id - e2->event_id;
+}
+
+static void add_event(epg_service_t *s, const uint8_t *p, int desc_len)
+{
+	unsigned int mjd, jtc, dur;
+	ts_epg_event_t *ev;
+
+	if (s->n_events >= s->max_events) {
+		ev = (ts_epg_event_t*)realloc(s->events, sizeof(ts_epg_event_t) * (s->max_events + 64));
+		if (!ev) {
+			return;
+		}
+		s->events = ev;
+		s->max_events += 64;
+	}
+	ev = &s->events[s->n_events++];
+
+	mjd = p[2] << 8 | p[3];
+	jtc = p[4] << 16 | p[5] << 8 | p[6];
+	dur = p[7] << 16 | p[8] << 8 | p[9];
+
+	ev->original_network_id = s->original_network_id;
+	ev->transport_stream_id = s->transport_stream_id;
+	ev->service_id = s->service_id;
+	ev->event_id = p[0] << 8 | p[1];
+	memset(&ev->start, 0, sizeof(ev->start));
+	ev->unknown_start = (mjd == 0xffff && jtc == 0xffffff);
+	if (!ev->unknown_start) {
+		ev->start.mjd = mjd;
+		mjd_to_ymd(mjd, &ev->start.year, &ev->start.mon, &ev->start.day);
+		ev->start.hour = bcd2(jtc >> 16);
+		ev->start.min = bcd2(jtc >> 8);
+		ev->start.sec = bcd2(jtc);
+	}
+	if (dur == 0xffffff) {
+		ev->duration = -1;
+	} else {
+		ev->duration = (bcd2(dur >> 16) * 60 + bcd2(dur >> 8)) * 60 + bcd2(dur);
+	}
+	ev->desc = &p[EPG_EVENT_SIZE];
+	ev->desc_len = desc_len;
+}
+
+static void build_index(epg_service_t *s)
+{
+	int i, j, event_id, desc_len;
+	uint8_t seen[0x10000 / 8];
+	const uint8_t *p, *end;
+	epg_table_t *t;
+
+	memset(seen, 0, sizeof(seen));
+	s->n_events = 0;
+	/* p/f̃e[uɗ̂ŁAԑgp/f̂̂c */
+	for (i = 0; i < EPG_N_TABLES; i++) {
+		t = s->tables[i];
+		if (!t) {
+			continue;
+		}
+		for (j = 0; j < 256; j++) {
+			if (!t->sections[j]) {
+				continue;
+			}
+			p = &t->sections[j][EPG_HEADER_SIZE];
+			end = &t->sections[j][t->lens[j] - 4];
+			while (end - p >= EPG_EVENT_SIZE) {
+				event_id = p[0] << 8 | p[1];
+				desc_len = (p[10] & 0x0f) << 8 | p[11];
+				if (&p[EPG_EVENT_SIZE + desc_len] > end) {
+					break;
+				}
+				if (!(seen[event_id / 8] & (1 << (event_id % 8)))) {
+					seen[event_id / 8] |= 1 << (event_id % 8);
+					add_event(s, p, desc_len);
+				}
+				p += EPG_EVENT_SIZE + desc_len;
+			}
+		}
+	}
+
+	if (s->n_events > 0) {
+		qsort(s->events, s->n_events, sizeof(ts_epg_event_t), cmp_start);
+	}
+	free(s->by_id);
+	s->by_id = (ts_epg_event_t**)malloc(sizeof(ts_epg_event_t*) * (s->n_events + 1));
+	if (!s->by_id) {
+		s->n_events = 0;
+		return;
+	}
+	for (i = 0; i < s->n_events; i++) {
+		s->by_id[i] = &s->events[i];
+	}
+	qsort(s->by_id, s->n_events, sizeof(ts_epg_event_t*), cmp_id);
+	s->dirty = 0;
+}
+
+int ts_epg_n_services(const ts_epg_t *epg)
+{
+	return epg->n_services;
+}
+
+/* iԖڂ̃T[rX̔ԑgJnɕԂ */
+int ts_epg_events(ts_epg_t *epg, int i, const ts_epg_event_t **events)
+{
+	epg_service_t *s;
+
+	if (i < 0 || i >= epg->n_services) {
+		return -1;
+	}
+	s = &epg->services[i];
+	if (s->dirty) {
+		build_index(s);
+	}
+	*events = s->events;
+	return s->n_events;
+}
+
+const ts_epg_event_t *ts_epg_find(ts_epg_t *epg, int original_network_id, int service_id, int event_id)
+{
+	int lo, hi, mid;
+	epg_service_t *s = find_service(epg, original_network_id, service_id);
+
+	if (!s) {
+		return NULL;
+	}
+	if (s->dirty) {
+		build_index(s);
+	}
+	lo = 0;
+	hi = s->n_events;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (s->by_id[mid]->event_id < event_id) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	if (lo < s->n_events && s->by_id[lo]->event_id == event_id) {
+		return s->by_id[lo];
+	}
+	return NULL;
+}
+
+void ts_epg_close(ts_epg_t *epg)
+{
+	int i, j, k;
+	epg_service_t *s;
+
+	for (i = 0; i < epg->n_services; i++) {
+		s = &epg->services[i];
+		for (j = 0; j < EPG_N_TABLES; j++) {
+			if (s->tables[j]) {
+				for (k = 0; k < 256; k++) {
+					free(s->tables[j]->sections[k]);
+				}
+				free(s->tables[j]);
+			}
+		}
+		free(s->events);
+		free(s->by_id);
+	}
+	free(epg->services);
+	free(epg);
+}
@@ -0,0 +1,25 @@
+/*
+	EIT̃XPW[(table_id 0x4E-0x6F)W߂Ĕԑg\
+	T[rX(original_network_id, service_id)ŋʂ
+*/
+typedef struct {
+	int original_network_id;
+	int transport_stream_id;
+	int service_id;
+	int event_id;
+	int unknown_start;
+	time_mjd_t start;
+	int duration; /* bBsȂ-1 */
+	/* Lqq[vBts_epg_packet()ĂԂ܂ŗL */
+	const uint8_t *desc;
+	int desc_len;
+} ts_epg_event_t;
+
+typedef struct ts_epg_s ts_epg_t;
+
+ts_epg_t *ts_epg_create();
+void ts_epg_packet(ts_epg_t *epg, const uint8_t *packet, const ts_header_t *tsh);
+int ts_epg_n_services(const ts_epg_t *epg);
+int ts_epg_events(ts_epg_t *epg, int i, const ts_epg_event_t **events);
+const ts_epg_event_t *ts_epg_find(ts_epg_t *epg, int original_network_id, int service_id, int event_id);
+void ts_epg_close(ts_epg_t *epg);
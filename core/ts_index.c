@@ -0,0 +1,279 @@
+#include "core/tsdump_def.h"
+
+#ifdef TSD_PLATFORM_MSVC
+#include <Windows.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "utils/arib_proginfo.h"
+#include "utils/arib_parser.h"
+#include "core/ts_index.h"
+
+/*
+	CfbNXt@Č` (lׂ͂ăgGfBA)
+	wb_   : "TSFIDX" 0x00 0x01, ͂̃TCY(8)
+	R[h : (1), yC[h(2), ͒̈ʒu(8), yC[h
+	wb_̓͂̃TCY͏݂Ƃɖ߂̂ŁArŎ~܂͎̂gȂ
+*/
+
+#define INDEX_MAGIC					"TSFIDX\0\1"
+#define INDEX_HEADER_SIZE			16
+#define INDEX_RECORD_HEADER_SIZE	11
+#define INDEX_MAX_PAYLOAD			(4 + MAX_PIDS_PER_SERVICE * 4)
+
+struct ts_index_s {
+	FILE *fp;
+	uint8_t *data;
+	size_t size;
+	size_t pos;
+};
+
+static inline void put16(uint8_t *p, unsigned int v)
+{
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put64(uint8_t *p, uint64_t v)
+{
+	int i;
+	for (i = 0; i < 8; i++) {
+		p[i] = (uint8_t)(v >> (i * 8));
+	}
+}
+
+static inline unsigned int get16(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+static inline uint64_t get64(const uint8_t *p)
+{
+	int i;
+	uint64_t v = 0;
+	for (i = 7; i >= 0; i--) {
+		v = (v << 8) | p[i];
+	}
+	return v;
+}
+
+static int put_time(uint8_t *p, const time_mjd_t *t)
+{
+	put16(p, t->mjd);
+	p[2] = (uint8_t)t->hour;
+	p[3] = (uint8_t)t->min;
+	p[4] = (uint8_t)t->sec;
+	return 5;
+}
+
+static void get_time(const uint8_t *p, time_mjd_t *t)
+{
+	t->mjd = get16(p);
+	mjd_to_ymd(t->mjd, &t->year, &t->mon, &t->day);
+	t->hour = p[2];
+	t->min = p[3];
+	t->sec = p[4];
+	t->usec = 0;
+}
+
+ts_index_t *ts_index_create(FILE *fp)
+{
+	uint8_t header[INDEX_HEADER_SIZE];
+	ts_index_t *idx;
+
+	memcpy(header, INDEX_MAGIC, 8);
+	put64(&header[8], 0);
+	if (fwrite(header, sizeof(header), 1, fp) != 1) {
+		return NULL;
+	}
+
+	idx = (ts_index_t*)malloc(sizeof(ts_index_t));
+	idx->fp = fp;
+	idx->data = NULL;
+	idx->size = idx->pos = 0;
+	return idx;
+}
+
+void ts_index_write(ts_index_t *idx, const ts_index_record_t *rec)
+{
+	int i, len = 0;
+	uint8_t buf[INDEX_RECORD_HEADER_SIZE + INDEX_MAX_PAYLOAD], *p = &buf[INDEX_RECORD_HEADER_SIZE];
+
+	switch (rec->type) {
+	case TS_INDEX_PAT:
+		for (i = 0; i < rec->n_items; i++) {
+			put16(&p[len], rec->items[i].id);
+			put16(&p[len + 2], rec->items[i].pid);
+			len += 4;
+		}
+		break;
+	case TS_INDEX_PMT:
+		put16(&p[0], rec->service_id);
+		put16(&p[2], rec->pid);
+		len = 4;
+		for (i = 0; i < rec->n_items; i++) {
+			p[len] = (uint8_t)rec->items[i].id;
+			put16(&p[len + 1], rec->items[i].pid);
+			len += 3;
+		}
+		break;
+	case TS_INDEX_EVENT:
+		put16(&p[0], rec->service_id);
+		put16(&p[2], rec->event_id);
+		p[4] = (uint8_t)rec->unknown_start;
+		len = 5 + put_time(&p[5], &rec->time);
+		break;
+	case TS_INDEX_PCR:
+		put16(&p[0], rec->pid);
+		put64(&p[2], rec->pcr);
+		len = 10;
+		break;
+	case TS_INDEX_TOT:
+		len = put_time(p, &rec->time);
+		break;
+	default:
+		return;
+	}
+
+	buf[0] = (uint8_t)rec->type;
+	put16(&buf[1], len);
+	put64(&buf[3], rec->offset);
+	fwrite(buf, INDEX_RECORD_HEADER_SIZE + len, 1, idx->fp);
+}
+
+/* wb_ɓ͂̃TCYŕBs0Ԃ */
+int ts_index_finish(ts_index_t *idx, int64_t input_size)
+{
+	uint8_t size[8];
+	int ret = 1;
+
+	put64(size, input_size);
+	if (fseek(idx->fp, 8, SEEK_SET) != 0 || fwrite(size, 8, 1, idx->fp) != 1) {
+		ret = 0;
+	}
+	if (fflush(idx->fp) != 0 || ferror(idx->fp)) {
+		ret = 0;
+	}
+	free(idx);
+	return ret;
+}
+
+/* ͂̃TCYvȂΎgȂ */
+ts_index_t *ts_index_load(FILE *fp, int64_t input_size)
+{
+	uint8_t header[INDEX_HEADER_SIZE];
+	uint8_t *data = NULL;
+	size_t size = 0, cap = 0, n;
+	ts_index_t *idx;
+
+	if (input_size <= 0 || fread(header, sizeof(header), 1, fp) != 1) {
+		return NULL;
+	}
+	if (memcmp(header, INDEX_MAGIC, 8) != 0 || (int64_t)get64(&header[8]) != input_size) {
+		return NULL;
+	}
+
+	do {
+		if (size == cap) {
+			cap = cap ? cap * 2 : 65536;
+			data = (uint8_t*)realloc(data, cap);
+		}
+		n = fread(&data[size], 1, cap - size, fp);
+		size += n;
+	} while (n > 0);
+
+	idx = (ts_index_t*)malloc(sizeof(ts_index_t));
+	idx->fp = NULL;
+	idx->data = data;
+	idx->size = size;
+	idx->pos = 0;
+	return idx;
+}
+
+/* ̃R[hǂށBIɒB0Ԃ */
+int ts_index_read(ts_index_t *idx, ts_index_record_t *rec)
+{
+	int i, len;
+	const uint8_t *p;
+
+	while (idx->pos + INDEX_RECORD_HEADER_SIZE <= idx->size) {
+		p = &idx->data[idx->pos];
+		rec->type = p[0];
+		len = get16(&p[1]);
+		rec->offset = (int64_t)get64(&p[3]);
+		if (idx->pos + INDEX_RECORD_HEADER_SIZE + len > idx->size || len > INDEX_MAX_PAYLOAD) {
+			break;
+		}
+		idx->pos += INDEX_RECORD_HEADER_SIZE + len;
+		p += INDEX_RECORD_HEADER_SIZE;
+
+		switch (rec->type) {
+		case TS_INDEX_PAT:
+			rec->n_items = len / 4;
+			if (rec->n_items > MAX_PIDS_PER_SERVICE) {
+				/* ꂽCfbNX */
+				rec->n_items = MAX_PIDS_PER_SERVICE;
+			}
+			for (i = 0; i < rec->n_items; i++) {
+				rec->items[i].id = get16(&p[i * 4]);
+				rec->items[i].pid = get16(&p[i * 4 + 2]);
+			}
+			return 1;
+		case TS_INDEX_PMT:
+			if (len < 4) {
+				continue;
+			}
+			rec->service_id = get16(&p[0]);
+			rec->pid = get16(&p[2]);
+			rec->n_items = (len - 4) / 3;
+			if (rec->n_items > MAX_PIDS_PER_SERVICE) {
+				/* ꂽCfbNX */
+				rec->n_items = MAX_PIDS_PER_SERVICE;
+			}
+			for (i = 0; i < rec->n_items; i++) {
+				rec->items[i].id = p[4 + i * 3];
+				rec->items[i].pid = get16(&p[4 + i * 3 + 1]);
+			}
+			return 1;
+		case TS_INDEX_EVENT:
+			if (len < 10) {
+				continue;
+			}
+			rec->service_id = get16(&p[0]);
+			rec->event_id = get16(&p[2]);
+			rec->unknown_start = p[4];
+			get_time(&p[5], &rec->time);
+			return 1;
+		case TS_INDEX_PCR:
+			if (len < 10) {
+				continue;
+			}
+			rec->pid = get16(&p[0]);
+			rec->pcr = get64(&p[2]);
+			return 1;
+		case TS_INDEX_TOT:
+			if (len < 5) {
+				continue;
+			}
+			get_time(p, &rec->time);
+			return 1;
+		}
+		/* mȂނ̃R[h͓ǂݔ΂ */
+	}
+	return 0;
+}
+
+void ts_index_rewind(ts_index_t *idx)
+{
+	idx->pos = 0;
+}
+
+void ts_index_close(ts_index_t *idx)
+{
+	free(idx->data);
+	free(idx);
+}
@@ -0,0 +1,41 @@
+#define TS_INDEX_PAT				1
+#define TS_INDEX_PMT				2
+#define TS_INDEX_EVENT				3
+#define TS_INDEX_PCR				4
+#define TS_INDEX_TOT				5
+
+typedef struct {
+	int id;
+	int pid;
+} ts_index_item_t;
+
+/*
+	PAT   : items = {service_id, PMTPID}
+	PMT   : service_id, pid = PCR_PID, items = {stream_type, PID}
+	EVENT : service_id, event_id, time = Jn, unknown_start
+	PCR   : pid, pcr = PCR_base
+	TOT   : time
+*/
+typedef struct {
+	int type;
+	int64_t offset;
+	int service_id;
+	int pid;
+	int event_id;
+	int unknown_start;
+	time_mjd_t time;
+	uint64_t pcr;
+	int n_items;
+	ts_index_item_t items[MAX_PIDS_PER_SERVICE];
+} ts_index_record_t;
+
+typedef struct ts_index_s ts_index_t;
+
+ts_index_t *ts_index_create(FILE *fp);
+void ts_index_write(ts_index_t *idx, const ts_index_record_t *rec);
+int ts_index_finish(ts_index_t *idx, int64_t input_size);
+
+ts_index_t *ts_index_load(FILE *fp, int64_t input_size);
+int ts_index_read(ts_index_t *idx, ts_index_record_t *rec);
+void ts_index_rewind(ts_index_t *idx);
+void ts_index_close(ts_index_t *idx);
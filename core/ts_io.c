@@ -0,0 +1,679 @@
+#include "core/tsdump_def.h"
+
+#ifdef TSD_PLATFORM_MSVC
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#ifdef __linux__
+#define _GNU_SOURCE
+#define TSD_HAVE_SPLICE
+#endif
+
+#ifdef TSD_PLATFORM_MSVC
+#include <Windows.h>
+#include <io.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <limits.h>
+
+#ifndef TSD_PLATFORM_MSVC
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#endif
+
+#include "core/ts_uring.h"
+#include "core/ts_io.h"
+
+#ifdef TSD_PLATFORM_MSVC
+static int map_input(ts_input_t *in)
+{
+	HANDLE hfile;
+	LARGE_INTEGER size;
+
+	hfile = (HANDLE)_get_osfhandle(_fileno(in->fp));
+	if (hfile == INVALID_HANDLE_VALUE || GetFileType(hfile) != FILE_TYPE_DISK) {
+		return 0;
+	}
+	if (!GetFileSizeEx(hfile, &size) || size.QuadPart <= 0 || (uint64_t)size.QuadPart > (SIZE_T)-1) {
+		return 0;
+	}
+	in->map_handle = CreateFileMapping(hfile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!in->map_handle) {
+		return 0;
+	}
+	in->map = (const uint8_t*)MapViewOfFile(in->map_handle, FILE_MAP_READ, 0, 0, 0);
+	if (!in->map) {
+		CloseHandle(in->map_handle);
+		return 0;
+	}
+	in->map_size = size.QuadPart;
+	return 1;
+}
+
+static void advise_input(ts_input_t *in)
+{
+	UNREF_ARG(in);
+}
+
+static void unmap_input(ts_input_t *in)
+{
+	UnmapViewOfFile(in->map);
+	CloseHandle(in->map_handle);
+}
+#else
+static int map_input(ts_input_t *in)
+{
+	struct stat st;
+	void *map;
+
+	if (fstat(fileno(in->fp), &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+		return 0;
+	}
+	if ((uint64_t)st.st_size > (size_t)-1) {
+		return 0;
+	}
+	map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fileno(in->fp), 0);
+	if (map == MAP_FAILED) {
+		return 0;
+	}
+	madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+	in->map = (const uint8_t*)map;
+	in->map_size = st.st_size;
+	return 1;
+}
+
+/* ǂݏoʒu̐ǂ݂AǂݏI̓}bsOORSS} */
+static void advise_input(ts_input_t *in)
+{
+	int64_t page = sysconf(_SC_PAGESIZE);
+	int64_t ahead, behind;
+
+	if (in->pos + TS_INPUT_MMAP_READAHEAD / 2 < in->advised) {
+		return;
+	}
+
+	ahead = in->map_size - in->advised;
+	if (ahead > TS_INPUT_MMAP_READAHEAD) {
+		ahead = TS_INPUT_MMAP_READAHEAD;
+	}
+	if (ahead > 0) {
+		madvise((void*)&in->map[in->advised], (size_t)ahead, MADV_WILLNEED);
+		in->advised += ahead;
+	}
+
+	behind = (in->pos - TS_INPUT_MMAP_READAHEAD) / page * page;
+	if (behind > 0) {
+		madvise((void*)in->map, (size_t)behind, MADV_DONTNEED);
+	}
+}
+
+static void unmap_input(ts_input_t *in)
+{
+	munmap((void*)in->map, (size_t)in->map_size);
+}
+#endif
+
+#ifdef TSD_HAVE_SPLICE
+struct ts_splice_s {
+	int in_fd;
+	int out_fd;
+	int null_fd;
+	int shadow[2];
+	int out_splice;
+	int null_splice;
+	int64_t shadow_offset; /* shadowpCv̐擪oCg̃Xg[̈ʒu */
+	uint8_t scratch[65536];
+};
+
+static int read_full(int fd, uint8_t *buf, int bytes)
+{
+	int n = 0;
+	ssize_t ret;
+	while (n < bytes) {
+		ret = read(fd, &buf[n], bytes - n);
+		if (ret < 0 && errno == EINTR) {
+			continue;
+		}
+		if (ret <= 0) {
+			break;
+		}
+		n += (int)ret;
+	}
+	return n;
+}
+
+static int write_full(int fd, const uint8_t *buf, int bytes)
+{
+	int n = 0;
+	ssize_t ret;
+	while (n < bytes) {
+		ret = write(fd, &buf[n], bytes - n);
+		if (ret < 0 && errno == EINTR) {
+			continue;
+		}
+		if (ret <= 0) {
+			return -1;
+		}
+		n += (int)ret;
+	}
+	return 0;
+}
+
+/* stdiñf[^shadowpCvteeŕĂAoCg[U[ԂɓǂݍށB
+   o͂shadowpCvsplicêŁA[U[Ԃ珑߂Rs[svɂȂB
+   tee͏1񂲂ƂshadowpCṽXbg1ĝŁAא؂̓͂ŃubN
+   ߂܂ő҂shadowpCvl܂B1oCgłǂ߂ĂΑ҂ɕԂāA
+   Ăяȍo͂shadowpCv󂯂 */
+static int splice_read(ts_input_t *in)
+{
+	struct ts_splice_s *s = in->splice;
+	ssize_t t;
+	int got = 0;
+
+	while (got < TS_INPUT_BLOCK_SIZE) {
+		t = tee(s->in_fd, s->shadow[1], TS_INPUT_BLOCK_SIZE - got, got > 0 ? SPLICE_F_NONBLOCK : 0);
+		if (t < 0 && errno == EINTR) {
+			continue;
+		}
+		if (t < 0 && errno == EAGAIN && got > 0) {
+			break;
+		}
+		if (t <= 0) {
+			if (t < 0) {
+				fprintf(stderr, "tee error\n");
+			}
+			break;
+		}
+		if (read_full(s->in_fd, &in->buf[got], (int)t) != (int)t) {
+			fprintf(stderr, "input read error\n");
+			break;
+		}
+		got += (int)t;
+	}
+	return got;
+}
+
+/* shadowpCv̐擪bytesoCgfdɑBfdȂ̂Ă */
+static int splice_move(struct ts_splice_s *s, int fd, int *use_splice, int64_t bytes)
+{
+	ssize_t ret;
+	size_t len;
+
+	while (bytes > 0) {
+		len = bytes > SSIZE_MAX ? SSIZE_MAX : (size_t)bytes;
+		if (*use_splice) {
+			ret = splice(s->shadow[0], NULL, fd, NULL, len, SPLICE_F_MOVE);
+			if (ret < 0 && errno == EINVAL) {
+				/* fdspliceɑΉĂȂ */
+				*use_splice = 0;
+				continue;
+			}
+		} else {
+			if (len > sizeof(s->scratch)) {
+				len = sizeof(s->scratch);
+			}
+			ret = read(s->shadow[0], s->scratch, len);
+			if (ret > 0 && fd >= 0 && write_full(fd, s->scratch, (int)ret) < 0) {
+				return -1;
+			}
+		}
+		if (ret < 0 && errno == EINTR) {
+			continue;
+		}
+		if (ret <= 0) {
+			return -1;
+		}
+		bytes -= ret;
+		s->shadow_offset += ret;
+	}
+	return 0;
+}
+
+static int splice_flush(ts_output_t *out, int final)
+{
+	struct ts_splice_s *s = out->splice;
+	int64_t offset;
+	int i;
+
+	for (i = 0; i < out->n_runs; i++) {
+		offset = out->run_offsets[i];
+		if (splice_move(s, s->null_fd, &s->null_splice, offset - s->shadow_offset) < 0 ||
+				splice_move(s, s->out_fd, &s->out_splice, out->runs[i].iov_len) < 0) {
+			return -1;
+		}
+	}
+	out->n_runs = 0;
+	if (final && out->decided > s->shadow_offset) {
+		return splice_move(s, s->null_fd, &s->null_splice, out->decided - s->shadow_offset);
+	}
+	return 0;
+}
+
+/* stdinpCvł΁Ao͂tee/spliceɂpXX[ɐ؂ւ */
+int ts_splice_open(ts_input_t *in, ts_output_t *out)
+{
+	struct stat st;
+	struct ts_splice_s *s;
+
+	if (in->uring || in->map || fstat(fileno(in->fp), &st) != 0 || !S_ISFIFO(st.st_mode) || out->uring) {
+		return 0;
+	}
+
+	s = (struct ts_splice_s*)malloc(sizeof(struct ts_splice_s));
+	if (pipe(s->shadow) != 0) {
+		free(s);
+		return 0;
+	}
+	/* 1ubNƒ[𗭂߂Ă邾̗eʂ΂悢 */
+	fcntl(s->shadow[1], F_SETPIPE_SZ, TS_INPUT_BLOCK_SIZE * 4);
+	s->in_fd = fileno(in->fp);
+	s->out_fd = out->fd;
+	s->null_fd = open("/dev/null", O_WRONLY);
+	s->out_splice = 1;
+	s->null_splice = (s->null_fd >= 0);
+	s->shadow_offset = in->pos;
+
+	in->splice = out->splice = s;
+	return 1;
+}
+
+/* tB^ꍇ̓[U[ԂoRstdinshadowpCvʂďo͂splice */
+int ts_splice_copy(ts_input_t *in, ts_output_t *out)
+{
+	struct ts_splice_s *s = in->splice;
+	ssize_t ret;
+	int64_t bytes;
+
+	do {
+		ret = splice(s->in_fd, NULL, s->shadow[1], NULL, TS_INPUT_BLOCK_SIZE, SPLICE_F_MOVE);
+	} while (ret < 0 && errno == EINTR);
+	if (ret < 0) {
+		out->error = 1;
+		return -1;
+	}
+	in->pos += ret;
+
+	/* --nosynčoHƓA̔[ȃpPbg͏o͂Ȃ */
+	bytes = (in->pos - s->shadow_offset) / 188 * 188;
+	if (splice_move(s, s->out_fd, &s->out_splice, bytes) < 0) {
+		out->error = 1;
+		return -1;
+	}
+	return (int)ret;
+}
+
+static void splice_close(struct ts_splice_s *s)
+{
+	close(s->shadow[0]);
+	close(s->shadow[1]);
+	if (s->null_fd >= 0) {
+		close(s->null_fd);
+	}
+	free(s);
+}
+#else
+int ts_splice_open(ts_input_t *in, ts_output_t *out)
+{
+	UNREF_ARG(in);
+	UNREF_ARG(out);
+	return 0;
+}
+
+int ts_splice_copy(ts_input_t *in, ts_output_t *out)
+{
+	UNREF_ARG(in);
+	UNREF_ARG(out);
+	return -1;
+}
+
+static int splice_read(ts_input_t *in)
+{
+	UNREF_ARG(in);
+	return -1;
+}
+#endif
+
+/* ͂ʏ̃t@Cł΁Aflagsɉio_uringmmapœǂށBȊOfreadœǂ */
+void ts_input_open(ts_input_t *in, FILE *fp, int flags)
+{
+	in->fp = fp;
+	in->buf = NULL;
+	in->map = NULL;
+	in->map_size = 0;
+	in->pos = 0;
+	in->advised = 0;
+	in->uring = NULL;
+	in->splice = NULL;
+
+#ifndef TSD_PLATFORM_MSVC
+	if (flags & TS_IO_URING) {
+		in->uring = ts_uring_input_open(fileno(fp), TS_INPUT_BLOCK_SIZE);
+		if (in->uring) {
+			return;
+		}
+		fprintf(stderr, "io_uring is not available for the input, fall back to stdio\n");
+	}
+#endif
+	if ((flags & TS_IO_MMAP) && map_input(in)) {
+		return;
+	}
+	in->map = NULL;
+	in->buf = (uint8_t*)malloc(TS_INPUT_BLOCK_SIZE);
+}
+
+/* ̃ubN̐擪*bufɕԂB*buf͎ts_input_readĂԂ܂ŗL */
+int ts_input_read(ts_input_t *in, const uint8_t **buf)
+{
+	int64_t bytes;
+
+	if (in->uring) {
+		bytes = ts_uring_input_read(in->uring, buf);
+	} else if (in->map) {
+		bytes = in->map_size - in->pos;
+		if (bytes > TS_INPUT_BLOCK_SIZE) {
+			bytes = TS_INPUT_BLOCK_SIZE;
+		}
+		*buf = &in->map[in->pos];
+	} else if (in->splice) {
+		bytes = splice_read(in);
+		*buf = in->buf;
+	} else {
+		bytes = fread(in->buf, 1, TS_INPUT_BLOCK_SIZE, in->fp);
+		*buf = in->buf;
+	}
+
+	if (bytes > 0) {
+		in->pos += bytes;
+		if (in->map) {
+			advise_input(in);
+		}
+	}
+	return (int)bytes;
+}
+
+/* ts_input_readƓAfreadȂǂœǂޏꍇdstɒړǂݍށB
+   mmap̏ꍇdstg킸}bṽ|C^Ԃ̂ŁA*buf͓͂܂ŗL */
+int ts_input_read_block(ts_input_t *in, uint8_t *dst, const uint8_t **buf)
+{
+	int bytes;
+	const uint8_t *p;
+
+	if (in->map || in->splice) {
+		return ts_input_read(in, buf);
+	}
+	if (in->uring) {
+		bytes = ts_input_read(in, &p);
+		if (bytes > 0) {
+			memcpy(dst, p, bytes);
+		}
+	} else {
+		bytes = (int)fread(dst, 1, TS_INPUT_BLOCK_SIZE, in->fp);
+		if (bytes > 0) {
+			in->pos += bytes;
+		}
+	}
+	*buf = dst;
+	return bytes;
+}
+
+/* ͂̑傫ԂBȂ-1 */
+int64_t ts_input_size(ts_input_t *in)
+{
+#ifdef TSD_PLATFORM_MSVC
+	int64_t cur, size;
+#else
+	off_t cur, size;
+#endif
+	if (in->map) {
+		return in->map_size;
+	}
+	if (in->uring || in->splice) {
+		return -1;
+	}
+#ifdef TSD_PLATFORM_MSVC
+	cur = _ftelli64(in->fp);
+	if (cur < 0 || _fseeki64(in->fp, 0, SEEK_END) != 0) {
+		return -1;
+	}
+	size = _ftelli64(in->fp);
+	_fseeki64(in->fp, cur, SEEK_SET);
+#else
+	cur = ftello(in->fp);
+	if (cur < 0 || fseeko(in->fp, 0, SEEK_END) != 0) {
+		return -1;
+	}
+	size = ftello(in->fp);
+	fseeko(in->fp, cur, SEEK_SET);
+#endif
+	return size;
+}
+
+/* ǂݏoʒuoffsetɈڂBłȂ0Ԃ */
+int ts_input_seek(ts_input_t *in, int64_t offset)
+{
+	if (in->map) {
+		if (offset > in->map_size) {
+			offset = in->map_size;
+		}
+		in->pos = offset;
+		in->advised = offset;
+		return 1;
+	}
+	if (in->uring || in->splice) {
+		return 0;
+	}
+#ifdef TSD_PLATFORM_MSVC
+	if (_fseeki64(in->fp, offset, SEEK_SET) != 0) {
+#else
+	if (fseeko(in->fp, (off_t)offset, SEEK_SET) != 0) {
+#endif
+		return 0;
+	}
+	in->pos = offset;
+	return 1;
+}
+
+void ts_input_close(ts_input_t *in)
+{
+#ifdef TSD_HAVE_SPLICE
+	if (in->splice) {
+		splice_close(in->splice);
+		in->splice = NULL;
+	}
+#endif
+	if (in->uring) {
+		ts_uring_input_close(in->uring);
+		in->uring = NULL;
+	}
+	if (in->map) {
+		unmap_input(in);
+		in->map = NULL;
+	}
+	free(in->buf);
+	in->buf = NULL;
+}
+
+void ts_output_open(ts_output_t *out, FILE *fp, int flags)
+{
+	out->fp = fp;
+	out->error = 0;
+	out->n_runs = 0;
+	out->uring = NULL;
+	out->splice = NULL;
+	out->map_base = NULL;
+	out->map_offset = 0;
+	out->decided = 0;
+#ifdef TSD_PLATFORM_MSVC
+	out->fd = -1;
+	UNREF_ARG(flags);
+#else
+	/* ȍ~stdiooRfdɒڏ */
+	fflush(fp);
+	out->fd = fileno(fp);
+	if (flags & TS_IO_URING) {
+		out->uring = ts_uring_output_open(out->fd);
+		if (!out->uring) {
+			fprintf(stderr, "io_uring is not available for the output, fall back to writev\n");
+		}
+	}
+#endif
+}
+
+static int flush_runs(ts_output_t *out, int final);
+
+/* ÕpPbgƃŘAĂΓɘA */
+void ts_output_packet(ts_output_t *out, const uint8_t *p, int bytes)
+{
+	ts_iovec_t *run;
+	int64_t offset;
+
+	if (out->splice) {
+		/* Ήt͕тƂɕς̂ŁAŃXg[̈ʒuɂĂ */
+		offset = out->map_offset + (p - out->map_base);
+		if (out->n_runs > 0) {
+			run = &out->runs[out->n_runs - 1];
+			if (out->run_offsets[out->n_runs - 1] + (int64_t)run->iov_len == offset) {
+				run->iov_len += bytes;
+				return;
+			}
+			if (out->n_runs >= TS_OUTPUT_MAX_RUNS) {
+				flush_runs(out, 0);
+			}
+		}
+		out->run_offsets[out->n_runs] = offset;
+		run = &out->runs[out->n_runs++];
+		run->iov_base = NULL;
+		run->iov_len = bytes;
+		return;
+	}
+
+	if (out->n_runs > 0) {
+		run = &out->runs[out->n_runs - 1];
+		if ((const uint8_t*)run->iov_base + run->iov_len == p) {
+			run->iov_len += bytes;
+			return;
+		}
+		if (out->n_runs >= TS_OUTPUT_MAX_RUNS) {
+			flush_runs(out, 0);
+		}
+	}
+
+	run = &out->runs[out->n_runs++];
+	run->iov_base = (void*)p;
+	run->iov_len = bytes;
+}
+
+static int flush_runs(ts_output_t *out, int final)
+{
+	int i;
+#ifndef TSD_PLATFORM_MSVC
+	ssize_t ret;
+	ts_iovec_t *iov = out->runs;
+	int n = out->n_runs;
+#endif
+
+	if (out->error) {
+		out->n_runs = 0;
+		return -1;
+	}
+
+#ifdef TSD_HAVE_SPLICE
+	if (out->splice) {
+		if (splice_flush(out, final) < 0) {
+			out->error = 1;
+			fprintf(stderr, "output write error\n");
+			return -1;
+		}
+		return 0;
+	}
+#endif
+	UNREF_ARG(final);
+	if (out->n_runs == 0) {
+		return 0;
+	}
+
+#ifdef TSD_PLATFORM_MSVC
+	for (i = 0; i < out->n_runs; i++) {
+		if (fwrite(out->runs[i].iov_base, out->runs[i].iov_len, 1, out->fp) != 1) {
+			out->error = 1;
+			break;
+		}
+	}
+#else
+	if (out->uring) {
+		/* ݎ̂io_uringŔ񓯊ɍs */
+		for (i = 0; i < n; i++) {
+			if (ts_uring_output_write(out->uring, (const uint8_t*)iov[i].iov_base, (int)iov[i].iov_len) < 0) {
+				out->error = 1;
+				break;
+			}
+		}
+		n = 0;
+	}
+	while (n > 0) {
+		ret = writev(out->fd, iov, n);
+		if (ret < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			out->error = 1;
+			break;
+		}
+		/* Ȃl߂ */
+		while (n > 0 && (size_t)ret >= iov->iov_len) {
+			ret -= iov->iov_len;
+			iov++;
+			n--;
+		}
+		if (n > 0) {
+			iov->iov_base = (uint8_t*)iov->iov_base + ret;
+			iov->iov_len -= ret;
+		}
+	}
+#endif
+
+	out->n_runs = 0;
+	if (out->error) {
+		fprintf(stderr, "output write error\n");
+		return -1;
+	}
+	return 0;
+}
+
+/* ܂Ă郉oB߂͌Ăяõobt@ėpĂ悢 */
+int ts_output_flush(ts_output_t *out)
+{
+	return flush_runs(out, 1);
+}
+
+/* splice[hŃpPbg̃|C^Xg[̈ʒu߂邽߂̑ΉtB
+   ȍ~ts_output_packetɓnpPbgɎgBdecidedÖʒu͏o͂邩ǂm肵Ă */
+void ts_output_map(ts_output_t *out, const uint8_t *base, int64_t offset, int64_t decided)
+{
+	out->map_base = base;
+	out->map_offset = offset;
+	out->decided = decided;
+}
+
+void ts_output_close(ts_output_t *out)
+{
+	ts_output_flush(out);
+	if (out->uring) {
+		if (ts_uring_output_close(out->uring) < 0 && !out->error) {
+			fprintf(stderr, "output write error\n");
+			out->error = 1;
+		}
+		out->uring = NULL;
+	}
+#ifdef TSD_PLATFORM_MSVC
+	fflush(out->fp);
+#endif
+}
@@ -0,0 +1,62 @@
+#define TS_INPUT_BLOCK_SIZE			(188 * 256)
+#define TS_INPUT_MMAP_READAHEAD		(32 * 1024 * 1024)
+
+#define TS_OUTPUT_MAX_RUNS			64
+
+#define TS_IO_MMAP					1
+#define TS_IO_URING					2
+
+#ifdef TSD_PLATFORM_MSVC
+typedef struct {
+	void *iov_base;
+	size_t iov_len;
+} ts_iovec_t;
+#else
+typedef struct iovec ts_iovec_t;
+#endif
+
+typedef struct {
+	FILE *fp;
+	int fd;
+	int error;
+	int n_runs;
+	ts_iovec_t runs[TS_OUTPUT_MAX_RUNS];
+	struct ts_uring_output_s *uring;
+	struct ts_splice_s *splice;
+	const uint8_t *map_base;
+	int64_t map_offset;
+	int64_t decided;
+	/* splice[hł̓Xg[̈ʒuŎ */
+	int64_t run_offsets[TS_OUTPUT_MAX_RUNS];
+} ts_output_t;
+
+void ts_output_open(ts_output_t *out, FILE *fp, int flags);
+void ts_output_packet(ts_output_t *out, const uint8_t *p, int bytes);
+int ts_output_flush(ts_output_t *out);
+void ts_output_map(ts_output_t *out, const uint8_t *base, int64_t offset, int64_t decided);
+void ts_output_close(ts_output_t *out);
+
+typedef struct {
+	FILE *fp;
+	uint8_t *buf;
+	/* mmap */
+	const uint8_t *map;
+	int64_t map_size;
+	int64_t pos;
+	int64_t advised;
+#ifdef TSD_PLATFORM_MSVC
+	void *map_handle;
+#endif
+	struct ts_uring_input_s *uring;
+	struct ts_splice_s *splice;
+} ts_input_t;
+
+void ts_input_open(ts_input_t *in, FILE *fp, int flags);
+int ts_input_read(ts_input_t *in, const uint8_t **buf);
+int ts_input_read_block(ts_input_t *in, uint8_t *dst, const uint8_t **buf);
+int64_t ts_input_size(ts_input_t *in);
+int ts_input_seek(ts_input_t *in, int64_t offset);
+void ts_input_close(ts_input_t *in);
+
+int ts_splice_open(ts_input_t *in, ts_output_t *out);
+int ts_splice_copy(ts_input_t *in, ts_output_t *out);
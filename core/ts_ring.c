@@ -0,0 +1,94 @@
+#include "core/tsdump_def.h"
+
+#ifdef TSD_PLATFORM_MSVC
+#include <Windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "utils/tsdthread.h"
+#include "core/ts_ring.h"
+
+/*
+	single-producer/single-consumer ̃Oobt@B
+	head  consumer Atail  producer i߂̂ŃbN͕svB
+	҂KvȂƂ mutex/cond ŐQB
+*/
+
+void ts_ring_create(ts_ring_t *ring, unsigned int size)
+{
+	unsigned int n = 1;
+	while (n < size) {
+		n *= 2;
+	}
+	ring->items = (void**)malloc(sizeof(void*) * n);
+	ring->size = n;
+	ring->head = 0;
+	ring->tail = 0;
+	ring->waiting = 0;
+	tsd_mutex_init(&ring->mutex);
+	tsd_cond_init(&ring->cond);
+}
+
+void ts_ring_delete(ts_ring_t *ring)
+{
+	tsd_cond_destroy(&ring->cond);
+	tsd_mutex_destroy(&ring->mutex);
+	free(ring->items);
+}
+
+static int ring_full(ts_ring_t *ring)
+{
+	return ring->tail - (unsigned int)tsd_atomic_load(&ring->head) >= ring->size;
+}
+
+static int ring_empty(ts_ring_t *ring)
+{
+	return (unsigned int)tsd_atomic_load(&ring->tail) == ring->head;
+}
+
+/* waiting𗧂ĂĂmF̂ŁA葤ring_wakeƍsႢɂȂȂ */
+static void ring_wait(ts_ring_t *ring, int (*blocked)(ts_ring_t*))
+{
+	tsd_mutex_lock(&ring->mutex);
+	tsd_atomic_store(&ring->waiting, 1);
+	while (blocked(ring)) {
+		tsd_cond_wait(&ring->cond, &ring->mutex);
+	}
+	tsd_atomic_store(&ring->waiting, 0);
+	tsd_mutex_unlock(&ring->mutex);
+}
+
+static void ring_wake(ts_ring_t *ring)
+{
+	if (tsd_atomic_load(&ring->waiting)) {
+		tsd_mutex_lock(&ring->mutex);
+		tsd_cond_broadcast(&ring->cond);
+		tsd_mutex_unlock(&ring->mutex);
+	}
+}
+
+void ts_ring_push(ts_ring_t *ring, void *item)
+{
+	if (ring_full(ring)) {
+		ring_wait(ring, ring_full);
+	}
+	ring->items[ring->tail & (ring->size - 1)] = item;
+	tsd_atomic_store(&ring->tail, ring->tail + 1);
+	ring_wake(ring);
+}
+
+void *ts_ring_pop(ts_ring_t *ring)
+{
+	void *item;
+	if (ring_empty(ring)) {
+		ring_wait(ring, ring_empty);
+	}
+	item = ring->items[ring->head & (ring->size - 1)];
+	tsd_atomic_store(&ring->head, ring->head + 1);
+	ring_wake(ring);
+	return item;
+}
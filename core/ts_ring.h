@@ -0,0 +1,14 @@
+typedef struct {
+	void **items;
+	unsigned int size;
+	unsigned int head;
+	unsigned int tail;
+	unsigned int waiting;
+	tsd_mutex_t mutex;
+	tsd_cond_t cond;
+} ts_ring_t;
+
+void ts_ring_create(ts_ring_t *ring, unsigned int size);
+void ts_ring_delete(ts_ring_t *ring);
+void ts_ring_push(ts_ring_t *ring, void *item);
+void *ts_ring_pop(ts_ring_t *ring);
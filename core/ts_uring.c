@@ -0,0 +1,561 @@
+#include "core/tsdump_def.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define TSD_HAVE_IO_URING
+#endif
+#endif
+
+#ifdef TSD_HAVE_IO_URING
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+#include "core/ts_uring.h"
+
+#ifdef TSD_HAVE_IO_URING
+
+/* liburingɂ͈ˑAKvŏ̃O삾OŎ */
+typedef struct {
+	int fd;
+	unsigned sq_entries;
+	unsigned *sq_head;
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_array;
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	void *sq_map;
+	void *cq_map;
+	size_t sq_map_size;
+	size_t cq_map_size;
+	size_t sqes_size;
+	unsigned to_submit;
+} uring_t;
+
+typedef enum {
+	SLOT_IDLE = 0,
+	SLOT_INFLIGHT,
+	SLOT_DONE
+} slot_stat_t;
+
+typedef struct {
+	slot_stat_t stat;
+	int64_t offset;
+	int filled;
+	int len;
+	uint8_t *buf;
+} uring_slot_t;
+
+struct ts_uring_input_s {
+	uring_t ring;
+	int fd;
+	int block_size;
+	int cur;
+	int held;
+	int eof;
+	int error;
+	int64_t next_offset;
+	uint8_t *mem;
+	uring_slot_t slots[TS_URING_READ_DEPTH];
+};
+
+struct ts_uring_output_s {
+	uring_t ring;
+	int fd;
+	int cur;
+	int error;
+	int64_t next_offset;
+	uint8_t *mem;
+	uring_slot_t slots[TS_URING_WRITE_DEPTH];
+};
+
+static int uring_probe_ops(uring_t *r)
+{
+	struct io_uring_probe *probe;
+	size_t size = sizeof(*probe) + 256 * sizeof(struct io_uring_probe_op);
+	int ok = 0;
+
+	probe = (struct io_uring_probe*)calloc(1, size);
+	if (syscall(__NR_io_uring_register, r->fd, IORING_REGISTER_PROBE, probe, 256) == 0) {
+		ok = probe->last_op >= IORING_OP_WRITE &&
+			(probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) &&
+			(probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED);
+	}
+	free(probe);
+	return ok;
+}
+
+static void uring_exit(uring_t *r)
+{
+	if (r->sqes) {
+		munmap(r->sqes, r->sqes_size);
+	}
+	if (r->cq_map && r->cq_map != r->sq_map) {
+		munmap(r->cq_map, r->cq_map_size);
+	}
+	if (r->sq_map) {
+		munmap(r->sq_map, r->sq_map_size);
+	}
+	close(r->fd);
+}
+
+static int uring_init(uring_t *r, unsigned entries)
+{
+	struct io_uring_params p;
+	uint8_t *sq, *cq;
+
+	memset(r, 0, sizeof(*r));
+	memset(&p, 0, sizeof(p));
+	r->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+	if (r->fd < 0) {
+		return 0;
+	}
+
+	r->sq_map_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	r->cq_map_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (r->cq_map_size > r->sq_map_size) {
+			r->sq_map_size = r->cq_map_size;
+		}
+		r->cq_map_size = r->sq_map_size;
+	}
+
+	r->sq_map = mmap(NULL, r->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+	if (r->sq_map == MAP_FAILED) {
+		r->sq_map = NULL;
+		goto ERR;
+	}
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		r->cq_map = r->sq_map;
+	} else {
+		r->cq_map = mmap(NULL, r->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+		if (r->cq_map == MAP_FAILED) {
+			r->cq_map = NULL;
+			goto ERR;
+		}
+	}
+	r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	r->sqes = (struct io_uring_sqe*)mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+	if (r->sqes == MAP_FAILED) {
+		r->sqes = NULL;
+		goto ERR;
+	}
+
+	sq = (uint8_t*)r->sq_map;
+	cq = (uint8_t*)r->cq_map;
+	r->sq_entries = p.sq_entries;
+	r->sq_head = (unsigned*)&sq[p.sq_off.head];
+	r->sq_tail = (unsigned*)&sq[p.sq_off.tail];
+	r->sq_mask = (unsigned*)&sq[p.sq_off.ring_mask];
+	r->sq_array = (unsigned*)&sq[p.sq_off.array];
+	r->cq_head = (unsigned*)&cq[p.cq_off.head];
+	r->cq_tail = (unsigned*)&cq[p.cq_off.tail];
+	r->cq_mask = (unsigned*)&cq[p.cq_off.ring_mask];
+	r->cqes = (struct io_uring_cqe*)&cq[p.cq_off.cqes];
+
+	if (!uring_probe_ops(r)) {
+		goto ERR;
+	}
+	return 1;
+
+ERR:
+	uring_exit(r);
+	return 0;
+}
+
+static int uring_prep_rw(uring_t *r, int op, int fd, void *buf, unsigned len, int64_t offset, uint64_t user_data)
+{
+	struct io_uring_sqe *sqe;
+	unsigned tail = *r->sq_tail, idx;
+
+	if (tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE) >= r->sq_entries) {
+		return 0;
+	}
+	idx = tail & *r->sq_mask;
+	sqe = &r->sqes[idx];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = (uint8_t)op;
+	sqe->fd = fd;
+	sqe->addr = (uint64_t)(uintptr_t)buf;
+	sqe->len = len;
+	sqe->off = (uint64_t)offset;
+	sqe->user_data = user_data;
+	r->sq_array[idx] = idx;
+	__atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+	r->to_submit++;
+	return 1;
+}
+
+static int uring_enter(uring_t *r, unsigned wait_nr)
+{
+	int ret;
+	do {
+		ret = (int)syscall(__NR_io_uring_enter, r->fd, r->to_submit, wait_nr,
+			wait_nr ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+	} while (ret < 0 && errno == EINTR);
+	if (ret < 0) {
+		return -1;
+	}
+	r->to_submit -= ret;
+	return 0;
+}
+
+static int uring_peek_cqe(uring_t *r, uint64_t *user_data, int *res)
+{
+	unsigned head = *r->cq_head;
+	struct io_uring_cqe *cqe;
+
+	if (head == __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE)) {
+		return 0;
+	}
+	cqe = &r->cqes[head & *r->cq_mask];
+	*user_data = cqe->user_data;
+	*res = cqe->res;
+	__atomic_store_n(r->cq_head, head + 1, __ATOMIC_RELEASE);
+	return 1;
+}
+
+static int is_seekable_file(int fd)
+{
+	struct stat st;
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+		return 0;
+	}
+	return 1;
+}
+
+static void input_submit(ts_uring_input_t *u, int i)
+{
+	uring_slot_t *s = &u->slots[i];
+	if (!uring_prep_rw(&u->ring, IORING_OP_READ, u->fd, &s->buf[s->filled],
+			s->len - s->filled, s->offset + s->filled, i)) {
+		u->error = 1;
+		s->stat = SLOT_DONE;
+		return;
+	}
+	s->stat = SLOT_INFLIGHT;
+}
+
+static void input_queue(ts_uring_input_t *u, int i)
+{
+	uring_slot_t *s = &u->slots[i];
+	if (u->eof) {
+		s->stat = SLOT_IDLE;
+		return;
+	}
+	s->offset = u->next_offset;
+	s->filled = 0;
+	u->next_offset += s->len;
+	input_submit(u, i);
+}
+
+static void input_reap(ts_uring_input_t *u)
+{
+	uint64_t user_data;
+	int res;
+	uring_slot_t *s;
+
+	while (uring_peek_cqe(&u->ring, &user_data, &res)) {
+		s = &u->slots[user_data];
+		if (res == -EINTR || res == -EAGAIN) {
+			input_submit(u, (int)user_data);
+		} else if (res < 0) {
+			u->error = 1;
+			s->stat = SLOT_DONE;
+		} else if (res == 0) {
+			/* EOFBȍ~̃ItZbg͓ǂ܂Ȃ */
+			u->eof = 1;
+			s->stat = SLOT_DONE;
+		} else {
+			s->filled += res;
+			if (s->filled < s->len) {
+				/* short read Ȃ̂Ŏcǂ */
+				input_submit(u, (int)user_data);
+			} else {
+				s->stat = SLOT_DONE;
+			}
+		}
+	}
+}
+
+/* ʏ̃t@Cɑ΂ĕubN̓ǂݍ݂ɔsĂBgȂłNULLԂ */
+ts_uring_input_t *ts_uring_input_open(int fd, int block_size)
+{
+	int i;
+	ts_uring_input_t *u;
+
+	if (!is_seekable_file(fd)) {
+		return NULL;
+	}
+	u = (ts_uring_input_t*)calloc(1, sizeof(ts_uring_input_t));
+	if (!uring_init(&u->ring, TS_URING_READ_DEPTH * 2)) {
+		free(u);
+		return NULL;
+	}
+	u->fd = fd;
+	u->block_size = block_size;
+	u->next_offset = lseek(fd, 0, SEEK_CUR);
+	if (u->next_offset < 0) {
+		u->next_offset = 0;
+	}
+	u->mem = (uint8_t*)malloc((size_t)block_size * TS_URING_READ_DEPTH);
+	for (i = 0; i < TS_URING_READ_DEPTH; i++) {
+		u->slots[i].buf = &u->mem[(size_t)block_size * i];
+		u->slots[i].len = block_size;
+		input_queue(u, i);
+	}
+	return u;
+}
+
+/* *buf͎ts_uring_input_readĂԂ܂ŗL */
+int ts_uring_input_read(ts_uring_input_t *u, const uint8_t **buf)
+{
+	uring_slot_t *s;
+
+	if (u->held) {
+		/* OԂubÑItZbg̓ǂݍ݂ɉ */
+		input_queue(u, u->cur);
+		u->cur = (u->cur + 1) % TS_URING_READ_DEPTH;
+		u->held = 0;
+	}
+
+	s = &u->slots[u->cur];
+	while (s->stat == SLOT_INFLIGHT) {
+		if (uring_enter(&u->ring, 1) < 0) {
+			u->error = 1;
+			break;
+		}
+		input_reap(u);
+	}
+	if (u->error) {
+		fprintf(stderr, "io_uring read error\n");
+		return -1;
+	}
+	if (s->stat != SLOT_DONE || s->filled == 0) {
+		return 0;
+	}
+
+	u->held = 1;
+	*buf = s->buf;
+	return s->filled;
+}
+
+void ts_uring_input_close(ts_uring_input_t *u)
+{
+	int i, inflight;
+
+	/* ǂݍݒ̃obt@Ȃ悤Ɋ҂ */
+	do {
+		inflight = 0;
+		for (i = 0; i < TS_URING_READ_DEPTH; i++) {
+			if (u->slots[i].stat == SLOT_INFLIGHT) {
+				inflight = 1;
+			}
+		}
+		if (inflight) {
+			u->eof = 1;
+			if (uring_enter(&u->ring, 1) < 0) {
+				break;
+			}
+			input_reap(u);
+		}
+	} while (inflight);
+
+	uring_exit(&u->ring);
+	free(u->mem);
+	free(u);
+}
+
+static void output_submit(ts_uring_output_t *u, int i)
+{
+	uring_slot_t *s = &u->slots[i];
+	if (!uring_prep_rw(&u->ring, IORING_OP_WRITE, u->fd, &s->buf[s->filled],
+			s->len - s->filled, s->offset + s->filled, i)) {
+		u->error = 1;
+		s->stat = SLOT_IDLE;
+		return;
+	}
+	s->stat = SLOT_INFLIGHT;
+}
+
+static void output_reap(ts_uring_output_t *u)
+{
+	uint64_t user_data;
+	int res;
+	uring_slot_t *s;
+
+	while (uring_peek_cqe(&u->ring, &user_data, &res)) {
+		s = &u->slots[user_data];
+		if (res == -EINTR || res == -EAGAIN) {
+			output_submit(u, (int)user_data);
+		} else if (res <= 0) {
+			u->error = 1;
+			s->stat = SLOT_IDLE;
+		} else {
+			s->filled += res;
+			if (s->filled < s->len) {
+				output_submit(u, (int)user_data);
+			} else {
+				s->stat = SLOT_IDLE;
+				s->len = 0;
+			}
+		}
+	}
+}
+
+static int output_wait(ts_uring_output_t *u, int i)
+{
+	while (u->slots[i].stat == SLOT_INFLIGHT) {
+		if (uring_enter(&u->ring, 1) < 0) {
+			u->error = 1;
+			break;
+		}
+		output_reap(u);
+	}
+	return u->error ? -1 : 0;
+}
+
+/* ݂̃Xe[WOobt@݂ɉ񂵁Ãobt@󂭂̂҂ */
+static int output_rotate(ts_uring_output_t *u)
+{
+	uring_slot_t *s = &u->slots[u->cur];
+
+	if (s->len > 0) {
+		s->offset = u->next_offset;
+		s->filled = 0;
+		u->next_offset += s->len;
+		output_submit(u, u->cur);
+		if (uring_enter(&u->ring, 0) < 0) {
+			u->error = 1;
+		}
+		u->cur = (u->cur + 1) % TS_URING_WRITE_DEPTH;
+	}
+	return output_wait(u, u->cur);
+}
+
+ts_uring_output_t *ts_uring_output_open(int fd)
+{
+	int i;
+	ts_uring_output_t *u;
+
+	/* O_APPENDł̓ItZbgw肪̂ŏۏ؂łȂ */
+	if (!is_seekable_file(fd) || (fcntl(fd, F_GETFL) & O_APPEND)) {
+		return NULL;
+	}
+	u = (ts_uring_output_t*)calloc(1, sizeof(ts_uring_output_t));
+	if (!uring_init(&u->ring, TS_URING_WRITE_DEPTH * 2)) {
+		free(u);
+		return NULL;
+	}
+	u->fd = fd;
+	u->next_offset = lseek(fd, 0, SEEK_CUR);
+	if (u->next_offset < 0) {
+		u->next_offset = 0;
+	}
+	u->mem = (uint8_t*)malloc((size_t)TS_URING_WRITE_SIZE * TS_URING_WRITE_DEPTH);
+	for (i = 0; i < TS_URING_WRITE_DEPTH; i++) {
+		u->slots[i].buf = &u->mem[(size_t)TS_URING_WRITE_SIZE * i];
+	}
+	return u;
+}
+
+/* f[^̓Xe[WOobt@ɃRs[̂ŁA߂͌Ăяõobt@ėpĂ悢 */
+int ts_uring_output_write(ts_uring_output_t *u, const uint8_t *p, int bytes)
+{
+	int n;
+	uring_slot_t *s;
+
+	while (bytes > 0) {
+		s = &u->slots[u->cur];
+		n = TS_URING_WRITE_SIZE - s->len;
+		if (n == 0) {
+			if (output_rotate(u) < 0) {
+				return -1;
+			}
+			continue;
+		}
+		if (n > bytes) {
+			n = bytes;
+		}
+		memcpy(&s->buf[s->len], p, n);
+		s->len += n;
+		p += n;
+		bytes -= n;
+	}
+	return u->error ? -1 : 0;
+}
+
+int ts_uring_output_close(ts_uring_output_t *u)
+{
+	int i, ret;
+
+	output_rotate(u);
+	for (i = 0; i < TS_URING_WRITE_DEPTH; i++) {
+		output_wait(u, i);
+	}
+	/* stdio悤Ƀt@Cʒu킹Ă */
+	lseek(u->fd, u->next_offset, SEEK_SET);
+	ret = u->error ? -1 : 0;
+
+	uring_exit(&u->ring);
+	free(u->mem);
+	free(u);
+	return ret;
+}
+
+#else
+
+ts_uring_input_t *ts_uring_input_open(int fd, int block_size)
+{
+	UNREF_ARG(fd);
+	UNREF_ARG(block_size);
+	return NULL;
+}
+
+int ts_uring_input_read(ts_uring_input_t *u, const uint8_t **buf)
+{
+	UNREF_ARG(u);
+	UNREF_ARG(buf);
+	return -1;
+}
+
+void ts_uring_input_close(ts_uring_input_t *u)
+{
+	UNREF_ARG(u);
+}
+
+ts_uring_output_t *ts_uring_output_open(int fd)
+{
+	UNREF_ARG(fd);
+	return NULL;
+}
+
+int ts_uring_output_write(ts_uring_output_t *u, const uint8_t *p, int bytes)
+{
+	UNREF_ARG(u);
+	UNREF_ARG(p);
+	UNREF_ARG(bytes);
+	return -1;
+}
+
+int ts_uring_output_close(ts_uring_output_t *u)
+{
+	UNREF_ARG(u);
+	return -1;
+}
+
+#endif
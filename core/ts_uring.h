@@ -0,0 +1,14 @@
+#define TS_URING_READ_DEPTH			16
+#define TS_URING_WRITE_DEPTH		8
+#define TS_URING_WRITE_SIZE			(188 * 4096)
+
+typedef struct ts_uring_input_s ts_uring_input_t;
+typedef struct ts_uring_output_s ts_uring_output_t;
+
+ts_uring_input_t *ts_uring_input_open(int fd, int block_size);
+int ts_uring_input_read(ts_uring_input_t *u, const uint8_t **buf);
+void ts_uring_input_close(ts_uring_input_t *u);
+
+ts_uring_output_t *ts_uring_output_open(int fd);
+int ts_uring_output_write(ts_uring_output_t *u, const uint8_t *p, int bytes);
+int ts_uring_output_close(ts_uring_output_t *u);
@@ -11,8 +11,14 @@
 #include <sys/types.h>
 #include <sys/timeb.h>
 
+#ifndef TSD_PLATFORM_MSVC
+#include <sys/uio.h>
+#include <pthread.h>
+#endif
+
 #ifdef TSD_PLATFORM_MSVC
 
+#include <Windows.h>
 #include <fcntl.h>
 #include <io.h>
 
@@ -29,28 +35,148 @@
 #include "utils/arib_proginfo.h"
 #include "utils/arib_parser.h"
 #include "utils/tsdstr.h"
+#include "utils/tsdthread.h"
+#include "utils/tsdcrc.h"
 #include "core/default_decoder.h"
+#include "core/ts_io.h"
+#include "core/ts_ring.h"
+#include "core/ts_index.h"
+#include "core/ts_batch.h"
+#include "core/ts_epg.h"
 
 #define TS_PACKET_SIZE 188
 
-static int set_filter = 0;
-static int filter_event_id = -1;
-static int filter_pids[256];
-static int n_filter_pids = 0;
-static int add_pat = 0;
-static int add_pmt = 0;
+/* Xbh[hŎgubN̐Bgpʂ͂œłɂȂ */
+#define PIPE_N_BLOCKS		32
+#define PIPE_RING_SIZE		64
+
+#define PSI_NONE			0
+#define PSI_PAT				1
+#define PSI_PMT				2
+#define PSI_EIT				3
+#define PSI_TOT				4
+
+/* 񃂁[h̃`N̑傫ƁA`N̎OPSI擾邽߂ɓǂޗ */
+#define PARALLEL_CHUNK_SIZE		(TS_INPUT_BLOCK_SIZE * 1024)
+#define PARALLEL_ACQUIRE_SIZE	(TS_INPUT_BLOCK_SIZE * 512)
+#define MAX_PARALLEL			64
+
+/* CfbNXǂݎn߂ʒúAr̃ZNV肱ڂȂ悤ɏOɂ */
+#define INDEX_SEEK_MARGIN	(TS_PACKET_SIZE * 16384)
+
+/* 1ubN𐮗񂵂Ƃ́ApPbgƃpPbg̕т̐̏ */
+#define MAX_BLOCK_PACKETS	((TS_INPUT_BLOCK_SIZE + TS_ALIGNMENT_MAX_REMAIN) / TS_PACKET_SIZE)
+#define MAX_PACKET_RUNS		(MAX_BLOCK_PACKETS + 1)
+
+/* o͂Ƃ̔32bit̃rbg}XNŎ̂ŁA32傫͂łȂ */
+#define MAX_OUTPUTS			16
+#define MAX_EVENT_IDS		64
+#define MAX_SWITCHES		(MAX_OUTPUTS * 2)
+
+typedef struct {
+	const TSDCHAR *file;
+	FILE *fp;
+	int set_filter;
+	int event_ids[MAX_EVENT_IDS];
+	int n_event_ids;
+	/* w肳ꂽԑgꂼxłǂ */
+	int event_seen[MAX_EVENT_IDS];
+	int pids[256];
+	int n_pids;
+	int service_ids[MAX_SERVICES_PER_CH];
+	int n_service_ids;
+	int add_pat;
+	int add_pmt;
+	/* ԑgƂɕꍇ̃t@C̃ev[g */
+	const TSDCHAR *split;
+	int split_event;
+	int split_keep;
+	TSDCHAR *next_file;
+	int error;
+	ts_output_t output;
+} output_spec_t;
+
+static output_spec_t outputs[MAX_OUTPUTS];
+static int n_outputs = 1;
+/* tB^w肵ĂȂo */
+static uint32_t unfiltered_mask = 0;
+/* o̓t@C̐؂ւKvȏo */
+static uint32_t pending_switches = 0;
+
 static int sync = 1;
+static int use_mmap = 1;
+static int use_uring = 0;
+static int use_splice = 0;
+static int use_threads = 0;
+static int n_parallel = 0;
+/* 192/204oCg̃pPbg^CX^v⃊[h\菜ďo͂ */
+static int strip_extra = 0;
+static int io_flags = 0;
+
+/* event_idŎw肳ꂽԑgׂďIǂݍ݂~߂BP\̕bTOTő */
+static int early_stop = 1;
+static int stop_grace = 0;
+static int stop_pending = 0;
+static int64_t stop_grace_start = -1;
+static int stop_reading = 0;
+
+static int64_t in_bytes = 0, out_bytes = 0;
+/* ̃pPbg̓͒̈ʒu */
+static int64_t packet_offset = 0;
+
+static const TSDCHAR *index_file = NULL;
+static FILE *index_fp = NULL;
+static ts_index_t *index_out = NULL;
+static ts_index_t *index_in = NULL;
+
+/* EIT̃XPW[ԑg\Iɏo */
+static const TSDCHAR *epg_file = NULL;
+static FILE *epg_fp = NULL;
+static ts_epg_t *epg = NULL;
+
+/* CfbNXɏݍς݂̏ */
+static struct {
+	int n_services;
+	uint32_t pmt_crc[MAX_SERVICES_PER_CH];
+	int event_ids[MAX_SERVICES_PER_CH];
+	int pcr_pid;
+	int pcr_valid;
+	uint64_t pcr;
+} index_state;
+
+#define SERVICE_NONE	0xff
 
 typedef struct
 {
 	unsigned int network_PID;
 	PSI_parse_t PAT;
 	PSI_parse_t PMTs[MAX_SERVICES_PER_CH];
+	/* ŌɎ󂯕tPMTCRCBPMTs[].crc32CRCȂZNVł */
+	uint32_t pmt_crc[MAX_SERVICES_PER_CH];
 	PSI_parse_t EIT0x12;
 	PSI_parse_t EIT0x26;
 	PSI_parse_t EIT0x27;
+	PSI_parse_t TOT;
 	int n_services;
+	/* proginfos͔ԑg̕܂ő傫̂ŁAT[rX̌⑖Ɏgl͂ɋl߂Ď */
+	uint16_t service_ids[MAX_SERVICES_PER_CH];
+	/* ݂̔ԑgevent_idBsȂ-1 */
+	int event_ids[MAX_SERVICES_PER_CH];
+	/* service_idPCRPIDT[rX̔ԍBYȂSERVICE_NONE */
+	uint8_t service_index[0x10000];
+	uint8_t pcr_index[0x2000];
 	proginfo_t proginfos[MAX_SERVICES_PER_CH];
+	/* PAT/PMT̓eς邽тɑ */
+	int psi_version;
+	/* PIDƂ̃ZNV̐U蕪BPMT̏ꍇpsi_indexŏ̃T[rX̔ԍ */
+	uint8_t psi_kind[0x2000];
+	uint8_t psi_index[0x2000];
+	/* PIDƂɏo͐rbg}XNŎBPAT/PMT/EITŏԂςƂ蒼 */
+	uint32_t pid_filter[0x2000];
+	int filter_dirty;
+	int filter_psi_version;
+	/* o͂ƂɁAw肳ꂽԑg̕ǂ */
+	int curr_events[MAX_OUTPUTS];
 } parse_set_t;
 
 static inline int64_t gettime()
@@ -82,30 +208,65 @@ static void pat_handler(void *param, const int n, const int i, const PAT_item_t
 	if (PAT_item->program_number != 0) {
 		set->PMTs[set->n_services].stat = PAYLOAD_STAT_INIT;
 		set->PMTs[set->n_services].pid = PAT_item->pid;
+		set->PMTs[set->n_services].crc32 = 0;
+		set->pmt_crc[set->n_services] = 0;
+		if (set->psi_kind[PAT_item->pid] == PSI_NONE) {
+			set->psi_kind[PAT_item->pid] = PSI_PMT;
+			set->psi_index[PAT_item->pid] = (uint8_t)set->n_services;
+		}
 		store_PAT(&set->proginfos[set->n_services], PAT_item);
+		set->service_ids[set->n_services] = (uint16_t)PAT_item->program_number;
+		if (set->service_index[PAT_item->program_number] == SERVICE_NONE) {
+			set->service_index[PAT_item->program_number] = (uint8_t)set->n_services;
+		}
+		set->event_ids[set->n_services] = -1;
 		(set->n_services)++;
+		set->psi_version++;
+		set->filter_dirty = 1;
 	}
 }
 
 static proginfo_t *find_curr_service(void *param, const unsigned int service_id)
 {
-	int i;
 	parse_set_t *set = (parse_set_t*)param;
-	for (i = 0; i < set->n_services; i++) {
-		if (service_id == set->proginfos[i].service_id) {
-			return &set->proginfos[i];
+	int i = set->service_index[service_id & 0xffff];
+	if (i == SERVICE_NONE) {
+		return NULL;
+	}
+	return &set->proginfos[i];
+}
+
+/* PMTςĂԁBPCRPID𕡐̃T[rXŋLĂꍇ͍ŏ̃T[rX */
+static void update_pcr_index(parse_set_t *set)
+{
+	int i;
+	memset(set->pcr_index, SERVICE_NONE, sizeof(set->pcr_index));
+	for (i = set->n_services - 1; i >= 0; i--) {
+		if (set->proginfos[i].status & PGINFO_GET_PMT) {
+			set->pcr_index[set->proginfos[i].PCR_pid & 0x1fff] = (uint8_t)i;
 		}
 	}
-	return NULL;
 }
 
 static proginfo_t *find_curr_service_eit(void *param, const EIT_header_t *eit_h)
 {
+	parse_set_t *set = (parse_set_t*)param;
 	if (eit_h->section_number != 0) {
 		/* ݐis̔ԑgł͂Ȃ */
 		return NULL;
 	}
-	return find_curr_service(param, eit_h->service_id);
+	return find_curr_service(set, eit_h->service_id);
+}
+
+/* EITŔԑg񂪍XVꂽĂ */
+static void update_event_ids(parse_set_t *set)
+{
+	int i;
+	proginfo_t *pi;
+	for (i = 0; i < set->n_services; i++) {
+		pi = &set->proginfos[i];
+		set->event_ids[i] = (pi->status & PGINFO_GET_EVENT_INFO) ? (int)pi->event_id : -1;
+	}
 }
 
 static void init_set(parse_set_t *set)
@@ -113,148 +274,1537 @@ static void init_set(parse_set_t *set)
 	int i;
 	set->PAT.pid = 0;
 	set->PAT.stat = PAYLOAD_STAT_INIT;
+	set->PAT.last_section.valid = 0;
 	set->EIT0x12.pid = 0x12;
 	set->EIT0x12.stat = PAYLOAD_STAT_INIT;
 	set->EIT0x26.pid = 0x26;
 	set->EIT0x26.stat = PAYLOAD_STAT_INIT;
 	set->EIT0x27.pid = 0x27;
 	set->EIT0x27.stat = PAYLOAD_STAT_INIT;
+	set->TOT.pid = 0x14;
+	set->TOT.stat = PAYLOAD_STAT_INIT;
+	memset(set->psi_kind, PSI_NONE, sizeof(set->psi_kind));
+	set->psi_kind[0x00] = PSI_PAT;
+	set->psi_kind[0x12] = PSI_EIT;
+	set->psi_kind[0x26] = PSI_EIT;
+	set->psi_kind[0x27] = PSI_EIT;
+	if (index_out || (early_stop && stop_grace > 0)) {
+		/* TOT̓CfbNXƓǂݍ݂~߂܂ł̗P\ɂgȂ */
+		set->psi_kind[0x14] = PSI_TOT;
+	}
 	set->n_services = 0;
+	set->psi_version = 0;
+	memset(set->service_index, SERVICE_NONE, sizeof(set->service_index));
+	memset(set->pcr_index, SERVICE_NONE, sizeof(set->pcr_index));
 	for (i = 0; i < MAX_SERVICES_PER_CH; i++) {
 		init_proginfo(&set->proginfos[i]);
+		set->event_ids[i] = -1;
+	}
+	set->filter_dirty = 1;
+	set->filter_psi_version = -1;
+	for (i = 0; i < MAX_OUTPUTS; i++) {
+		set->curr_events[i] = -1;
+	}
+}
+
+static void add_service_pids(uint32_t bit, parse_set_t *set, int service_id)
+{
+	int i, j;
+	proginfo_t *pi;
+	for (i = 0; i < set->n_services; i++) {
+		if ((int)set->service_ids[i] != service_id) {
+			continue;
+		}
+		pi = &set->proginfos[i];
+		set->pid_filter[set->PMTs[i].pid & 0x1fff] |= bit;
+		if (pi->status & PGINFO_GET_PMT) {
+			set->pid_filter[pi->PCR_pid & 0x1fff] |= bit;
+			for (j = 0; j < pi->n_service_pids; j++) {
+				set->pid_filter[pi->service_pids[j].pid & 0x1fff] |= bit;
+			}
+		}
+	}
+}
+
+static int event_index(output_spec_t *o, int event_id)
+{
+	int i;
+	for (i = 0; i < o->n_event_ids; i++) {
+		if (o->event_ids[i] == event_id) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static int match_event(output_spec_t *o, int event_id)
+{
+	return event_index(o, event_id) >= 0;
+}
+
+static int event_gated(output_spec_t *o)
+{
+	return (o->n_event_ids > 0 || o->split);
+}
+
+static proginfo_t *split_service(output_spec_t *o, parse_set_t *set)
+{
+	if (set->n_services == 0) {
+		return NULL;
+	}
+	if (o->n_service_ids > 0) {
+		return find_curr_service(set, o->service_ids[0]);
+	}
+	return &set->proginfos[0];
+}
+
+static TSDCHAR *make_split_filename(output_spec_t *o, const proginfo_t *pi)
+{
+	TSDCHAR *file, sid[16], eid[16], start[32];
+	tsdstr_replace_set_t sets[3];
+	size_t n_sets = 0;
+
+	tsd_snprintf(sid, tsd_sizeof(sid), TSD_TEXT("%d"), pi->service_id);
+	tsd_snprintf(eid, tsd_sizeof(eid), TSD_TEXT("%d"), pi->event_id);
+	if (pi->status & PGINFO_UNKNOWN_STARTTIME) {
+		tsd_strlcpy(start, TSD_TEXT("unknown"), tsd_sizeof(start));
+	} else {
+		tsd_snprintf(start, tsd_sizeof(start), TSD_TEXT("%04d%02d%02d%02d%02d"),
+			pi->start.year, pi->start.mon, pi->start.day, pi->start.hour, pi->start.min);
+	}
+	TSD_REPLACE_ADD_SET(sets, n_sets, TSD_TEXT("{sid}"), sid);
+	TSD_REPLACE_ADD_SET(sets, n_sets, TSD_TEXT("{eid}"), eid);
+	TSD_REPLACE_ADD_SET(sets, n_sets, TSD_TEXT("{start}"), start);
+
+	file = (TSDCHAR*)malloc(sizeof(TSDCHAR) * MAX_PATH_LEN);
+	tsd_strlcpy(file, o->split, MAX_PATH_LEN);
+	tsd_replace_sets(file, MAX_PATH_LEN - 1, sets, n_sets, 0);
+	return file;
+}
+
+/* Ώۂ̃T[rX݂̌̔ԑgςĂo̓t@C̐؂ւ\񂷂 */
+static int update_split(output_spec_t *o, uint32_t bit, parse_set_t *set)
+{
+	int event_id = -1;
+	proginfo_t *pi = split_service(o, set);
+
+	if (pi && (pi->status & PGINFO_GET_EVENT_INFO)) {
+		event_id = pi->event_id;
+	}
+	if (event_id == o->split_event) {
+		return o->split_keep;
+	}
+	o->split_event = event_id;
+	o->split_keep = (event_id >= 0 && (o->n_event_ids == 0 || match_event(o, event_id)));
+
+	free(o->next_file);
+	o->next_file = NULL;
+	if (o->split_keep) {
+		o->next_file = make_split_filename(o, pi);
+	}
+	pending_switches |= bit;
+	return o->split_keep;
+}
+
+static void stop_input()
+{
+	if (!stop_reading) {
+		fprintf(stderr, "stop reading because the requested events have ended\n");
+		stop_reading = 1;
+	}
+}
+
+/* ׂĂ̏o͂event_idōi荞܂ĂāAw肳ꂽԑgǂIĂ΁Aȏo͂pPbg͖ */
+static int events_finished(parse_set_t *set)
+{
+	int i, k;
+	output_spec_t *o;
+
+	for (k = 0; k < n_outputs; k++) {
+		o = &outputs[k];
+		if (!o->set_filter || o->split || o->n_event_ids == 0 || set->curr_events[k]) {
+			return 0;
+		}
+		for (i = 0; i < o->n_event_ids; i++) {
+			if (!o->event_seen[i]) {
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+static void update_stop(parse_set_t *set)
+{
+	if (!events_finished(set)) {
+		/* P\̊Ԃɔԑg߂Ă */
+		stop_pending = 0;
+		return;
+	}
+	if (stop_grace == 0) {
+		stop_input();
+	} else if (!stop_pending) {
+		/* TOTP\𐔂 */
+		stop_pending = 1;
+		stop_grace_start = -1;
 	}
 }
 
-static int is_pat(int pid)
+static void update_filter(parse_set_t *set)
 {
-	return (pid == 0x00);
+	int i, j, k, curr_event, changed;
+	uint32_t bit, keep_all = 0;
+	output_spec_t *o;
+
+	set->filter_dirty = 0;
+	changed = (set->psi_version != set->filter_psi_version);
+
+	for (k = 0; k < n_outputs; k++) {
+		o = &outputs[k];
+		curr_event = 0;
+		if (o->split) {
+			curr_event = update_split(o, 1u << k, set);
+		} else if (o->n_event_ids > 0) {
+			for (i = 0; i < set->n_services; i++) {
+				j = set->event_ids[i] >= 0 ? event_index(o, set->event_ids[i]) : -1;
+				if (j >= 0) {
+					/* 񃂁[hłearly_stop؂Ă烏[J[̂ŁAoutputsɏނ̂1Xbh */
+					if (early_stop) {
+						o->event_seen[j] = 1;
+					}
+					curr_event = 1;
+				}
+			}
+		}
+		if (curr_event != set->curr_events[k]) {
+			set->curr_events[k] = curr_event;
+			changed = 1;
+		}
+	}
+	if (early_stop) {
+		update_stop(set);
+	}
+
+	if (!changed) {
+		return;
+	}
+	set->filter_psi_version = set->psi_version;
+
+	for (k = 0; k < n_outputs; k++) {
+		o = &outputs[k];
+		if (!o->set_filter) {
+			keep_all |= 1u << k;
+		} else if (set->curr_events[k] && o->n_pids == 0 && o->n_service_ids == 0 && !o->add_pat && !o->add_pmt) {
+			/* PID̎w肪Δԑg̑SpPbgo͂ */
+			keep_all |= 1u << k;
+		}
+	}
+	for (i = 0; i < 0x2000; i++) {
+		set->pid_filter[i] = keep_all;
+	}
+
+	for (k = 0; k < n_outputs; k++) {
+		o = &outputs[k];
+		bit = 1u << k;
+		if (!o->set_filter || (keep_all & bit)) {
+			continue;
+		}
+		if (event_gated(o) && !set->curr_events[k]) {
+			continue;
+		}
+		for (i = 0; i < o->n_pids; i++) {
+			if (o->pids[i] < 0x2000) {
+				set->pid_filter[o->pids[i]] |= bit;
+			}
+		}
+		for (i = 0; i < o->n_service_ids; i++) {
+			add_service_pids(bit, set, o->service_ids[i]);
+		}
+		if (o->add_pat) {
+			set->pid_filter[0x00] |= bit;
+		}
+		if (o->add_pmt) {
+			for (i = 0; i < set->n_services; i++) {
+				set->pid_filter[set->PMTs[i].pid & 0x1fff] |= bit;
+			}
+		}
+	}
+}
+
+static inline uint32_t filter(const int pid, parse_set_t *set)
+{
+	if (set->filter_dirty) {
+		update_filter(set);
+	}
+	return set->pid_filter[pid];
 }
 
-static int is_pmt(int pid, parse_set_t *set)
+static void index_write_pat(parse_set_t *set)
 {
 	int i;
+	ts_index_record_t rec;
+
+	rec.type = TS_INDEX_PAT;
+	rec.offset = packet_offset;
+	rec.n_items = set->n_services;
 	for (i = 0; i < set->n_services; i++) {
-		if (pid == (int)set->PMTs[i].pid) {
-			return 1;
+		rec.items[i].id = set->proginfos[i].service_id;
+		rec.items[i].pid = set->PMTs[i].pid;
+	}
+	ts_index_write(index_out, &rec);
+}
+
+static void index_write_pmt(const proginfo_t *pi)
+{
+	int i;
+	ts_index_record_t rec;
+
+	rec.type = TS_INDEX_PMT;
+	rec.offset = packet_offset;
+	rec.service_id = pi->service_id;
+	rec.pid = pi->PCR_pid;
+	rec.n_items = pi->n_service_pids;
+	for (i = 0; i < pi->n_service_pids; i++) {
+		rec.items[i].id = pi->service_pids[i].stream_type;
+		rec.items[i].pid = pi->service_pids[i].pid;
+	}
+	ts_index_write(index_out, &rec);
+}
+
+static void index_write_event(const proginfo_t *pi)
+{
+	ts_index_record_t rec;
+
+	rec.type = TS_INDEX_EVENT;
+	rec.offset = packet_offset;
+	rec.service_id = pi->service_id;
+	rec.event_id = pi->event_id;
+	rec.unknown_start = !!(pi->status & PGINFO_UNKNOWN_STARTTIME);
+	rec.time = pi->start;
+	ts_index_write(index_out, &rec);
+}
+
+/* PAT/PMT/EITŏԂςĂ΃CfbNXɏ */
+static void index_update(parse_set_t *set)
+{
+	int i;
+	proginfo_t *pi;
+
+	if (set->n_services != index_state.n_services) {
+		index_write_pat(set);
+		index_state.n_services = set->n_services;
+	}
+	for (i = 0; i < set->n_services; i++) {
+		pi = &set->proginfos[i];
+		if ((pi->status & PGINFO_GET_PMT) && set->pmt_crc[i] != index_state.pmt_crc[i]) {
+			index_write_pmt(pi);
+			index_state.pmt_crc[i] = set->pmt_crc[i];
+		}
+		if (set->event_ids[i] >= 0 && set->event_ids[i] != index_state.event_ids[i]) {
+			index_write_event(pi);
+			index_state.event_ids[i] = set->event_ids[i];
 		}
 	}
-	return 0;
+	/* PCR͍ŏ̃T[rX̂̂L^ */
+	if (set->n_services > 0 && (set->proginfos[0].status & PGINFO_GET_PMT)) {
+		index_state.pcr_pid = set->proginfos[0].PCR_pid;
+	}
+}
+
+static proginfo_t *index_pcr_handler(void *param, const unsigned int pid)
+{
+	parse_set_t *set = (parse_set_t*)param;
+	int i = set->pcr_index[pid & 0x1fff];
+	if (i == SERVICE_NONE) {
+		return NULL;
+	}
+	return &set->proginfos[i];
+}
+
+/* PCR1bƂɋL^ */
+static void index_pcr(const uint8_t *p, const ts_header_t *tsh, parse_set_t *set)
+{
+	uint64_t diff;
+	ts_index_record_t rec;
+	proginfo_t *pi = index_pcr_handler(set, tsh->pid);
+
+	if (!pi) {
+		return;
+	}
+	parse_PCR(p, tsh, set, index_pcr_handler);
+	if (!(pi->status & PGINFO_PCR_UPDATED)) {
+		return;
+	}
+	pi->status &= ~PGINFO_PCR_UPDATED;
+
+	diff = (pi->PCR_base + PCR_BASE_MAX - index_state.pcr) % PCR_BASE_MAX;
+	if (index_state.pcr_valid && diff < PCR_BASE_HZ) {
+		return;
+	}
+	rec.type = TS_INDEX_PCR;
+	rec.offset = packet_offset;
+	rec.pid = tsh->pid;
+	rec.pcr = pi->PCR_base;
+	ts_index_write(index_out, &rec);
+	index_state.pcr = pi->PCR_base;
+	index_state.pcr_valid = 1;
+}
+
+static void tot_handler(void *param, const time_mjd_t *time)
+{
+	int64_t t;
+	ts_index_record_t rec;
+	UNREF_ARG(param);
+
+	if (index_out) {
+		rec.type = TS_INDEX_TOT;
+		rec.offset = packet_offset;
+		rec.time = *time;
+		ts_index_write(index_out, &rec);
+	}
+	if (stop_pending) {
+		t = (int64_t)time->mjd * 86400 + time->hour * 3600 + time->min * 60 + time->sec;
+		if (stop_grace_start < 0) {
+			stop_grace_start = t;
+		} else if (t - stop_grace_start >= stop_grace) {
+			stop_input();
+		}
+	}
+}
+
+static void print_progress()
+{
+	static int64_t last_print = 0;
+	int64_t t = gettime();
+	if (t > last_print + 500) {
+		fprintf(stderr, "in: %10"PRId64", out: %10"PRId64"\r", in_bytes, out_bytes);
+		fflush(stderr);
+		last_print = t;
+	}
 }
 
-static int filter(const int pid, parse_set_t *set)
+/* pPbg͂āAo͐̃rbg}XNԂBhbts_batch_headersŃfR[hς݂̃wb_ */
+static uint32_t process_packet(const uint8_t *p, const ts_batch_t *hb, int c, parse_set_t *set)
+{
+	int i, eit_updated, pmt_updated, pid = hb->pid[c];
+	uint32_t crc;
+	ts_header_t tsh;
+
+	if (!hb->valid[c]) {
+		return unfiltered_mask;
+	}
+	/* قƂǂ̃pPbg̓fR[hς݂̃wb_Ŕł */
+	if (hb->transport_scrambling_control[c]) {
+		return filter(pid, set);
+	}
+	if (set->psi_kind[pid] == PSI_NONE && !hb->payload_unit_start_indicator[c] &&
+			!(index_out && (set->filter_dirty || pid == index_state.pcr_pid))) {
+		return filter(pid, set);
+	}
+
+	if (!parse_ts_header(p, &tsh)) {
+		return unfiltered_mask;
+	}
+	/* PSIPIDȊO̓ZNV̉͂ʂȂ */
+	if (!tsh.transport_scrambling_control) {
+		switch (set->psi_kind[tsh.pid]) {
+		case PSI_PAT:
+			if (set->n_services == 0) {
+				parse_PAT(&set->PAT, p, &tsh, set, pat_handler);
+			}
+			break;
+		case PSI_PMT:
+			/* ̃T[rXPMTPIDLĂꍇ */
+			pmt_updated = 0;
+			for (i = set->psi_index[tsh.pid]; i < set->n_services; i++) {
+				if (set->PMTs[i].pid == tsh.pid) {
+					parse_PMT(p, &tsh, &set->PMTs[i], &set->proginfos[i]);
+					/* last_PMT͎󂯕tPMTłXV */
+					crc = set->proginfos[i].last_PMT.crc32;
+					if (set->proginfos[i].last_PMT.valid && crc != set->pmt_crc[i]) {
+						set->pmt_crc[i] = crc;
+						set->psi_version++;
+						set->filter_dirty = 1;
+						pmt_updated = 1;
+					}
+				}
+			}
+			if (pmt_updated) {
+				update_pcr_index(set);
+			}
+			break;
+		case PSI_EIT:
+			if (epg) {
+				ts_epg_packet(epg, p, &tsh);
+			}
+			if (set->n_services > 0) {
+				if (tsh.pid == 0x12) {
+					eit_updated = parse_EIT(&set->EIT0x12, p, &tsh, set, find_curr_service_eit);
+				} else if (tsh.pid == 0x26) {
+					eit_updated = parse_EIT(&set->EIT0x26, p, &tsh, set, find_curr_service_eit);
+				} else {
+					eit_updated = parse_EIT(&set->EIT0x27, p, &tsh, set, find_curr_service_eit);
+				}
+				/* đĂZNVł͔ԑg͕ςȂ */
+				if (eit_updated) {
+					update_event_ids(set);
+					set->filter_dirty = 1;
+				}
+			}
+			break;
+		case PSI_TOT:
+			parse_TOT_TDT(p, &tsh, &set->TOT, set, tot_handler);
+			break;
+		}
+		if (index_out) {
+			if (set->filter_dirty) {
+				index_update(set);
+			}
+			if ((int)tsh.pid == index_state.pcr_pid) {
+				index_pcr(p, &tsh, set);
+			}
+		}
+	}
+	return filter((int)tsh.pid, set);
+}
+
+/* ς݂ŁAł͏łAĂpPbg̕ */
+typedef struct {
+	const uint8_t *pkts;
+	int n;
+	int64_t offset;
+	/* pPbg̑傫ƁA̒TSpPbgn܂ʒu */
+	int size;
+	int header;
+} packet_run_t;
+
+/*
+	ǂݍ񂾃ubNpPbg̕тɕBend̓ubN̒̓͒̈ʒuB
+	*decidedɂ́A܂ł̃f[^o͂邩ǂm肵ʒuԂB
+	bufNULLȂΓ͂̏IŁAtB^Ɏz[тɂ
+*/
+static int split_packets(ts_alignment_filter_t *f, const uint8_t *buf, int bytes, int64_t end, packet_run_t *runs, int64_t *decided)
 {
 	int i;
-	int curr_event = 0, no_hit = 0;
 
-	if (!set_filter) {
+	if (!f) {
+		runs[0].pkts = buf;
+		runs[0].n = bytes / TS_PACKET_SIZE;
+		runs[0].offset = end - bytes;
+		runs[0].size = TS_PACKET_SIZE;
+		runs[0].header = 0;
+		*decided = runs[0].offset + (int64_t)runs[0].n * TS_PACKET_SIZE;
 		return 1;
 	}
+	if (buf) {
+		ts_alignment_filter_runs(f, buf, bytes);
+	} else {
+		ts_alignment_filter_finish(f);
+	}
+	for (i = 0; i < f->n_runs; i++) {
+		runs[i].pkts = f->runs[i].data;
+		runs[i].size = f->runs[i].packet_size;
+		runs[i].header = f->runs[i].header_offset;
+		runs[i].n = f->runs[i].bytes / runs[i].size;
+		runs[i].offset = end - f->bytes + f->runs[i].pos;
+	}
+	*decided = end - f->remain;
+	return f->n_runs;
+}
+
+/* pPbĝo͂镔 */
+static inline int output_pos(const packet_run_t *run)
+{
+	return strip_extra ? run->header : 0;
+}
+
+static inline int output_len(const packet_run_t *run)
+{
+	return strip_extra ? TS_PACKET_SIZE : run->size;
+}
+
+static void output_packet(const uint8_t *p, int bytes, uint32_t mask)
+{
+	int k;
+	for (k = 0; mask; k++, mask >>= 1) {
+		if ((mask & 1) && outputs[k].fp) {
+			ts_output_packet(&outputs[k].output, p, bytes);
+		}
+	}
+}
 
-	if (filter_event_id > 0) {
-		for (i = 0; i < set->n_services; i++) {
-			if (set->proginfos[i].status & PGINFO_GET_EVENT_INFO) {
-				if ((int)set->proginfos[i].event_id == filter_event_id) {
-					curr_event = 1;
+static void close_output(output_spec_t *o)
+{
+	ts_output_close(&o->output);
+	if (o->output.error) {
+		o->error = 1;
+	}
+}
+
+/* [h̏o̓t@CāAfileΐVJBfile͉ */
+static void switch_output(output_spec_t *o, TSDCHAR *file)
+{
+	if (o->fp) {
+		close_output(o);
+		fclose(o->fp);
+		o->fp = NULL;
+	}
+	if (file) {
+		o->fp = my_fopen(file, TSD_TEXT("wb"));
+		if (o->fp) {
+			my_fprintf(stderr, TSD_TEXT("output: %s\n"), file);
+			ts_output_open(&o->output, o->fp, io_flags);
+		} else {
+			my_fprintf(stderr, TSD_TEXT("file open error: %s\n"), file);
+			o->error = 1;
+		}
+		free(file);
+	}
+}
+
+/* \񂳂ꂽo̓t@C̐؂ւs */
+static void apply_switches()
+{
+	int k;
+	for (k = 0; pending_switches; k++, pending_switches >>= 1) {
+		if (pending_switches & 1) {
+			switch_output(&outputs[k], outputs[k].next_file);
+			outputs[k].next_file = NULL;
+		}
+	}
+}
+
+/* ǂꂩ̏o͂ŃG[-1Ԃ */
+static int flush_outputs()
+{
+	int k, ret = 0;
+	for (k = 0; k < n_outputs; k++) {
+		if (outputs[k].fp && ts_output_flush(&outputs[k].output) < 0) {
+			ret = -1;
+		}
+	}
+	return ret;
+}
+
+static int close_outputs()
+{
+	int k, ret = 0;
+	for (k = 0; k < n_outputs; k++) {
+		if (outputs[k].split) {
+			switch_output(&outputs[k], NULL);
+			free(outputs[k].next_file);
+			outputs[k].next_file = NULL;
+		} else {
+			close_output(&outputs[k]);
+		}
+		if (outputs[k].error) {
+			ret = 1;
+		}
+	}
+	return ret;
+}
+
+typedef struct {
+	uint8_t *buf;
+	const uint8_t *data;
+	int bytes;
+	/* ǂݍ񂾒̓͂̈ʒu */
+	int64_t pos;
+	int n_pkts;
+	/* pPbgƂɏo͂镔 */
+	const uint8_t *pkts[MAX_BLOCK_PACKETS];
+	uint8_t lens[MAX_BLOCK_PACKETS];
+	uint32_t masks[MAX_BLOCK_PACKETS];
+	/* ÕubNɂ܂pPbg͐tB^̒łȂ킳̂ŁAɃRs[Ă */
+	uint8_t stitch[TS_ALIGNMENT_STITCH_SIZE];
+	/* o̓t@C̐؂ւ̓pPbg̏ǂɏ݃Xbhōs */
+	int n_switches;
+	struct {
+		int pkt;
+		int output;
+		TSDCHAR *file;
+	} switches[MAX_SWITCHES];
+} pipe_block_t;
+
+/*
+	ǂݍ݁/tB^oꂼʂ̃XbhōsB
+	ubN free_blocks  read_blocks  parsed_blocks  free_blocks Ə񂵁A
+	ǂ̃OY҂Ə҂1XbhɂȂĂBNULL͏I[\
+*/
+typedef struct {
+	ts_input_t *input;
+	ts_ring_t free_blocks;
+	ts_ring_t read_blocks;
+	ts_ring_t parsed_blocks;
+	unsigned int abort;
+} pipeline_t;
+
+static void reader_thread(void *param)
+{
+	pipeline_t *pl = (pipeline_t*)param;
+	pipe_block_t *b;
+
+	while (!tsd_atomic_load(&pl->abort)) {
+		b = (pipe_block_t*)ts_ring_pop(&pl->free_blocks);
+		b->bytes = ts_input_read_block(pl->input, b->buf, &b->data);
+		if (b->bytes <= 0) {
+			break;
+		}
+		b->pos = pl->input->pos;
+		ts_ring_push(&pl->read_blocks, b);
+	}
+	ts_ring_push(&pl->read_blocks, NULL);
+}
+
+static void writer_thread(void *param)
+{
+	pipeline_t *pl = (pipeline_t*)param;
+	pipe_block_t *b;
+	int i, j;
+
+	while ((b = (pipe_block_t*)ts_ring_pop(&pl->parsed_blocks)) != NULL) {
+		for (i = 0, j = 0; i < b->n_pkts; i++) {
+			for (; j < b->n_switches && b->switches[j].pkt == i; j++) {
+				switch_output(&outputs[b->switches[j].output], b->switches[j].file);
+			}
+			output_packet(b->pkts[i], b->lens[i], b->masks[i]);
+		}
+		for (; j < b->n_switches; j++) {
+			switch_output(&outputs[b->switches[j].output], b->switches[j].file);
+		}
+		if (flush_outputs() < 0) {
+			tsd_atomic_store(&pl->abort, 1);
+		}
+		ts_ring_push(&pl->free_blocks, b);
+	}
+}
+
+static void add_switches(pipe_block_t *b, int pkt)
+{
+	int k;
+	for (k = 0; k < n_outputs; k++) {
+		if (!(pending_switches & (1u << k))) {
+			continue;
+		}
+		if (b->n_switches >= MAX_SWITCHES) {
+			/* c͎̃pPbgōs */
+			return;
+		}
+		b->switches[b->n_switches].pkt = pkt;
+		b->switches[b->n_switches].output = k;
+		b->switches[b->n_switches].file = outputs[k].next_file;
+		b->n_switches++;
+		outputs[k].next_file = NULL;
+		pending_switches &= ~(1u << k);
+	}
+}
+
+/* XbhȂ-1Ԃ */
+static int run_pipeline(ts_input_t *input, parse_set_t *set)
+{
+	int i, c, r, n_runs, n_stitch, last = 0, ret = -1;
+	int64_t decided;
+	const uint8_t *pkts, *p;
+	pipe_block_t *blocks, *b;
+	pipeline_t pl;
+	tsd_thread_t reader, writer;
+	ts_alignment_filter_t f;
+	ts_batch_t hb;
+	packet_run_t runs[MAX_PACKET_RUNS];
+
+	pl.input = input;
+	pl.abort = 0;
+	ts_ring_create(&pl.free_blocks, PIPE_RING_SIZE);
+	ts_ring_create(&pl.read_blocks, PIPE_RING_SIZE);
+	ts_ring_create(&pl.parsed_blocks, PIPE_RING_SIZE);
+
+	blocks = (pipe_block_t*)malloc(sizeof(pipe_block_t) * PIPE_N_BLOCKS);
+	for (i = 0; i < PIPE_N_BLOCKS; i++) {
+		blocks[i].buf = (uint8_t*)malloc(TS_INPUT_BLOCK_SIZE);
+		ts_ring_push(&pl.free_blocks, &blocks[i]);
+	}
+
+	if (!tsd_thread_create(&writer, writer_thread, &pl)) {
+		goto end;
+	}
+	if (!tsd_thread_create(&reader, reader_thread, &pl)) {
+		ts_ring_push(&pl.parsed_blocks, NULL);
+		tsd_thread_join(writer);
+		goto end;
+	}
+
+	if (sync) {
+		create_ts_alignment_filter(&f);
+	}
+
+	while (!last) {
+		b = (pipe_block_t*)ts_ring_pop(&pl.read_blocks);
+		if (!b) {
+			if (!sync || tsd_atomic_load(&pl.abort)) {
+				break;
+			}
+			/* ͂̏IŁAtB^Ɏz[̃ubNŏ */
+			b = (pipe_block_t*)ts_ring_pop(&pl.free_blocks);
+			b->data = NULL;
+			b->bytes = 0;
+			b->pos = input->pos;
+			last = 1;
+		}
+		b->n_pkts = 0;
+		b->n_switches = 0;
+		in_bytes += b->bytes;
+		if (tsd_atomic_load(&pl.abort)) {
+			/* ݂Ɏsǂݍ݂~߂̂ŁAǂݍ݃Xbh~܂܂ŋ񂵂 */
+			ts_ring_push(&pl.parsed_blocks, b);
+			continue;
+		}
+		n_runs = split_packets(sync ? &f : NULL, b->data, b->bytes, b->pos, runs, &decided);
+		n_stitch = 0;
+		for (r = 0; r < n_runs; r++) {
+			pkts = runs[r].pkts;
+			if (sync && pkts >= f.stitch && pkts < &f.stitch[sizeof(f.stitch)]) {
+				/* tB^̒̃obt@͎̃ubNŏ㏑ */
+				memcpy(&b->stitch[n_stitch], pkts, runs[r].n * runs[r].size);
+				pkts = &b->stitch[n_stitch];
+				n_stitch += runs[r].n * runs[r].size;
+			}
+			for (c = 0; c < runs[r].n; c++, b->n_pkts++) {
+				p = &pkts[c * runs[r].size];
+				if (c % TS_BATCH_SIZE == 0) {
+					ts_batch_headers(&hb, &p[runs[r].header], runs[r].size, runs[r].n - c);
+				}
+				packet_offset = runs[r].offset + (int64_t)c * runs[r].size;
+				b->pkts[b->n_pkts] = &p[output_pos(&runs[r])];
+				b->lens[b->n_pkts] = (uint8_t)output_len(&runs[r]);
+				b->masks[b->n_pkts] = process_packet(&p[runs[r].header], &hb, c % TS_BATCH_SIZE, set);
+				if (pending_switches) {
+					add_switches(b, b->n_pkts);
+				}
+				if (b->masks[b->n_pkts]) {
+					out_bytes += b->lens[b->n_pkts];
 				}
 			}
 		}
-		if (!curr_event) {
-			return 0;
+		ts_ring_push(&pl.parsed_blocks, b);
+		print_progress();
+		if (stop_reading) {
+			tsd_atomic_store(&pl.abort, 1);
 		}
 	}
 
-	if (n_filter_pids > 0) {
-		for (i = 0; i < n_filter_pids; i++) {
-			if (pid == filter_pids[i]) {
-				return 1;
+	ts_ring_push(&pl.parsed_blocks, NULL);
+	tsd_thread_join(reader);
+	tsd_thread_join(writer);
+	if (sync) {
+		delete_ts_alignment_filter(&f);
+	}
+	ret = 0;
+
+end:
+	for (i = 0; i < PIPE_N_BLOCKS; i++) {
+		free(blocks[i].buf);
+	}
+	free(blocks);
+	ts_ring_delete(&pl.parsed_blocks);
+	ts_ring_delete(&pl.read_blocks);
+	ts_ring_delete(&pl.free_blocks);
+	return ret;
+}
+
+/* 񃂁[hŃ`NƂɏo͂pPbg͈̔́B͂̃}bvw */
+typedef struct {
+	int64_t start;
+	int64_t end;
+	int done;
+	int64_t out_bytes;
+	int n_runs[MAX_OUTPUTS];
+	int cap_runs[MAX_OUTPUTS];
+	ts_iovec_t *runs[MAX_OUTPUTS];
+} chunk_t;
+
+/*
+	͂`Nɕĕ̃Xbhŉ/tB^ACXbh`N̏ɏoB
+	eXbh̓`NPARALLEL_ACQUIRE_SIZEOǂݎn߂āAPAT/PMT/EIT擾Ăo͂n߂
+*/
+typedef struct {
+	const uint8_t *map;
+	int64_t size;
+	chunk_t *chunks;
+	int n_chunks;
+	int next;
+	int written;
+	int max_ahead;
+	int abort;
+	tsd_mutex_t mutex;
+	tsd_cond_t cond;
+} parallel_t;
+
+static void add_run(chunk_t *ch, int k, const uint8_t *p, int bytes)
+{
+	ts_iovec_t *run;
+
+	if (ch->n_runs[k] > 0) {
+		run = &ch->runs[k][ch->n_runs[k] - 1];
+		if ((const uint8_t*)run->iov_base + run->iov_len == p) {
+			run->iov_len += bytes;
+			return;
+		}
+	}
+	if (ch->n_runs[k] == ch->cap_runs[k]) {
+		ch->cap_runs[k] = ch->cap_runs[k] ? ch->cap_runs[k] * 2 : 256;
+		ch->runs[k] = (ts_iovec_t*)realloc(ch->runs[k], sizeof(ts_iovec_t) * ch->cap_runs[k]);
+	}
+	run = &ch->runs[k][ch->n_runs[k]++];
+	run->iov_base = (void*)p;
+	run->iov_len = bytes;
+}
+
+static void process_chunk(parallel_t *pp, chunk_t *ch, parse_set_t *set, ts_alignment_filter_t *f)
+{
+	int c, r, k, n_runs, bytes;
+	int64_t pos, offset, decided;
+	uint32_t mask;
+	const uint8_t *p;
+	ts_batch_t hb;
+	packet_run_t runs[MAX_PACKET_RUNS];
+
+	/* ƃubN̋؂𑵂邽߂ɃubNPʂŖ߂ */
+	pos = ch->start - PARALLEL_ACQUIRE_SIZE;
+	if (pos < 0) {
+		pos = 0;
+	}
+	pos = pos / TS_INPUT_BLOCK_SIZE * TS_INPUT_BLOCK_SIZE;
+
+	init_set(set);
+	if (f) {
+		reset_ts_alignment_filter(f);
+	}
+	do {
+		bytes = TS_INPUT_BLOCK_SIZE;
+		if (bytes > pp->size - pos) {
+			bytes = (int)(pp->size - pos);
+		}
+		/* Ō͋̃ubNŁAtB^Ɏz[ */
+		n_runs = split_packets(f, bytes > 0 ? &pp->map[pos] : NULL, bytes, pos + bytes, runs, &decided);
+		for (r = 0; r < n_runs; r++) {
+			for (c = 0; c < runs[r].n; c++) {
+				offset = runs[r].offset + (int64_t)c * runs[r].size;
+				if (offset >= ch->end) {
+					return;
+				}
+				p = &runs[r].pkts[c * runs[r].size];
+				if (c % TS_BATCH_SIZE == 0) {
+					ts_batch_headers(&hb, &p[runs[r].header], runs[r].size, runs[r].n - c);
+				}
+				mask = process_packet(&p[runs[r].header], &hb, c % TS_BATCH_SIZE, set);
+				if (offset < ch->start || !mask) {
+					continue;
+				}
+				/* ̃pPbg͓͏łAĂ̂ŁA}bv𒼐ڎw */
+				for (k = 0; mask; k++, mask >>= 1) {
+					if (mask & 1) {
+						add_run(ch, k, &pp->map[offset + output_pos(&runs[r])], output_len(&runs[r]));
+					}
+				}
+				ch->out_bytes += output_len(&runs[r]);
+			}
+		}
+		pos += bytes;
+	} while (bytes > 0);
+}
+
+static void parallel_worker(void *param)
+{
+	parallel_t *pp = (parallel_t*)param;
+	parse_set_t *set = (parse_set_t*)malloc(sizeof(parse_set_t));
+	ts_alignment_filter_t f;
+	int i;
+
+	if (sync) {
+		create_ts_alignment_filter(&f);
+	}
+	while (1) {
+		tsd_mutex_lock(&pp->mutex);
+		/* o҂Ă`NƂ͑҂ */
+		while (!pp->abort && pp->next < pp->n_chunks && pp->next >= pp->written + pp->max_ahead) {
+			tsd_cond_wait(&pp->cond, &pp->mutex);
+		}
+		if (pp->abort || pp->next >= pp->n_chunks) {
+			tsd_mutex_unlock(&pp->mutex);
+			break;
+		}
+		i = pp->next++;
+		tsd_mutex_unlock(&pp->mutex);
+
+		process_chunk(pp, &pp->chunks[i], set, sync ? &f : NULL);
+
+		tsd_mutex_lock(&pp->mutex);
+		pp->chunks[i].done = 1;
+		tsd_cond_broadcast(&pp->cond);
+		tsd_mutex_unlock(&pp->mutex);
+	}
+	if (sync) {
+		delete_ts_alignment_filter(&f);
+	}
+	free(set);
+}
+
+/* XbhȂ-1Ԃ */
+static int run_parallel(ts_input_t *input)
+{
+	int i, j, k, n_threads = 0, ret = 0;
+	parallel_t pp;
+	chunk_t *ch;
+	tsd_thread_t threads[MAX_PARALLEL];
+
+	pp.map = input->map;
+	pp.size = input->map_size;
+	pp.n_chunks = (int)((pp.size + PARALLEL_CHUNK_SIZE - 1) / PARALLEL_CHUNK_SIZE);
+	pp.chunks = (chunk_t*)calloc(pp.n_chunks > 0 ? pp.n_chunks : 1, sizeof(chunk_t));
+	for (i = 0; i < pp.n_chunks; i++) {
+		pp.chunks[i].start = (int64_t)i * PARALLEL_CHUNK_SIZE;
+		pp.chunks[i].end = pp.chunks[i].start + PARALLEL_CHUNK_SIZE;
+	}
+	if (pp.n_chunks > 0) {
+		pp.chunks[pp.n_chunks - 1].end = pp.size;
+	}
+	pp.next = 0;
+	pp.written = 0;
+	pp.max_ahead = n_parallel * 2;
+	pp.abort = 0;
+	tsd_mutex_init(&pp.mutex);
+	tsd_cond_init(&pp.cond);
+
+	for (i = 0; i < n_parallel; i++) {
+		if (!tsd_thread_create(&threads[n_threads], parallel_worker, &pp)) {
+			break;
+		}
+		n_threads++;
+	}
+	if (n_threads == 0) {
+		ret = -1;
+		goto end;
+	}
+
+	for (i = 0; i < pp.n_chunks; i++) {
+		ch = &pp.chunks[i];
+		tsd_mutex_lock(&pp.mutex);
+		while (!ch->done) {
+			tsd_cond_wait(&pp.cond, &pp.mutex);
+		}
+		tsd_mutex_unlock(&pp.mutex);
+
+		for (k = 0; k < n_outputs; k++) {
+			for (j = 0; j < ch->n_runs[k]; j++) {
+				ts_output_packet(&outputs[k].output, (const uint8_t*)ch->runs[k][j].iov_base, (int)ch->runs[k][j].iov_len);
 			}
+			free(ch->runs[k]);
+			ch->runs[k] = NULL;
+		}
+		in_bytes = ch->end;
+		out_bytes += ch->out_bytes;
+		print_progress();
+
+		tsd_mutex_lock(&pp.mutex);
+		if (flush_outputs() < 0) {
+			pp.abort = 1;
+			ret = 1;
+		}
+		pp.written = i + 1;
+		tsd_cond_broadcast(&pp.cond);
+		tsd_mutex_unlock(&pp.mutex);
+		if (ret) {
+			break;
 		}
-		no_hit = 1;
 	}
 
-	if (add_pat) {
-		if (is_pat(pid)) {
-			return 1;
+	for (i = 0; i < n_threads; i++) {
+		tsd_thread_join(threads[i]);
+	}
+end:
+	for (i = 0; i < pp.n_chunks; i++) {
+		for (k = 0; k < n_outputs; k++) {
+			free(pp.chunks[i].runs[k]);
+		}
+	}
+	free(pp.chunks);
+	tsd_cond_destroy(&pp.cond);
+	tsd_mutex_destroy(&pp.mutex);
+	return ret;
+}
+
+/* 񃂁[hgȂΗR\0Ԃ */
+static int parallel_available(ts_input_t *input, int n_ranges)
+{
+	int k;
+
+	if (n_parallel <= 1 || n_ranges >= 0) {
+		return 0;
+	}
+	if (use_threads || use_splice) {
+		fprintf(stderr, "parallel mode is not used with --threads or --splice\n");
+		return 0;
+	}
+	if (!input->map) {
+		fprintf(stderr, "parallel mode is not used because the input is not a mapped file\n");
+		return 0;
+	}
+	if (index_out) {
+		fprintf(stderr, "parallel mode is not used while creating an index\n");
+		return 0;
+	}
+	if (epg) {
+		fprintf(stderr, "parallel mode is not used while building the EPG\n");
+		return 0;
+	}
+	for (k = 0; k < n_outputs; k++) {
+		if (outputs[k].split) {
+			fprintf(stderr, "parallel mode is not used with split outputs\n");
+			return 0;
 		}
-		no_hit = 1;
 	}
+	return 1;
+}
 
-	if (add_pmt) {
-		if (is_pmt(pid, set)) {
+/* endO܂œǂŏBendȂ΍Ō܂ */
+static int scan_input(ts_input_t *input, parse_set_t *set, ts_alignment_filter_t *f, int64_t end)
+{
+	int n_in, n_runs, r, c, last = 0, done = 0;
+	const uint8_t *buf, *p;
+	uint32_t mask;
+	int64_t decided;
+	ts_batch_t hb;
+	packet_run_t runs[MAX_PACKET_RUNS];
+
+	while (!done && !last) {
+		n_in = ts_input_read(input, &buf);
+		if (n_in <= 0) {
+			if (!f) {
+				break;
+			}
+			/* ͂̏IŁAtB^Ɏz[ */
+			buf = NULL;
+			n_in = 0;
+			last = 1;
+		}
+		n_runs = split_packets(f, buf, n_in, input->pos, runs, &decided);
+		if (use_splice) {
+			ts_output_map(&outputs[0].output, buf, input->pos - n_in, decided);
+		}
+		for (r = 0; r < n_runs && !done; r++) {
+			if (use_splice) {
+				/* Ȃ킹pPbg͓͂̃obt@̊Oɂ̂ŕтƂɑΉt */
+				ts_output_map(&outputs[0].output, runs[r].pkts, runs[r].offset, decided);
+			}
+			for (c = 0; c < runs[r].n; c++) {
+				p = &runs[r].pkts[c * runs[r].size];
+				packet_offset = runs[r].offset + (int64_t)c * runs[r].size;
+				if ((end >= 0 && packet_offset >= end) || stop_reading) {
+					done = 1;
+					break;
+				}
+				in_bytes += runs[r].size;
+				print_progress();
+
+				if (c % TS_BATCH_SIZE == 0) {
+					ts_batch_headers(&hb, &p[runs[r].header], runs[r].size, runs[r].n - c);
+				}
+				mask = process_packet(&p[runs[r].header], &hb, c % TS_BATCH_SIZE, set);
+				if (pending_switches) {
+					apply_switches();
+				}
+				if (mask) {
+					output_packet(&p[output_pos(&runs[r])], output_len(&runs[r]), mask);
+					out_bytes += output_len(&runs[r]);
+				}
+			}
+		}
+		/* ̃ubNbuf㏑Oɂ܂Ƃ߂ďo */
+		if (flush_outputs() < 0) {
 			return 1;
 		}
-		no_hit = 1;
 	}
+	return 0;
+}
 
-	if (curr_event && !no_hit) {
-		return 1;
+/* CfbNXoffset܂ł̓ePAT/PMT/݂̔ԑg𕜌 */
+static void seed_set(parse_set_t *set, int64_t offset)
+{
+	static ts_index_record_t pat, pmts[MAX_SERVICES_PER_CH], events[MAX_SERVICES_PER_CH];
+	ts_index_record_t rec;
+	PAT_item_t item;
+	proginfo_t *pi;
+	int i, j, got_pat = 0;
+
+	for (i = 0; i < MAX_SERVICES_PER_CH; i++) {
+		pmts[i].type = events[i].type = 0;
+	}
+	ts_index_rewind(index_in);
+	while (ts_index_read(index_in, &rec) && rec.offset <= offset) {
+		if (rec.type == TS_INDEX_PAT) {
+			pat = rec;
+			got_pat = 1;
+		} else if (rec.type == TS_INDEX_PMT || rec.type == TS_INDEX_EVENT) {
+			for (i = 0; got_pat && i < pat.n_items && i < MAX_SERVICES_PER_CH; i++) {
+				if (pat.items[i].id == rec.service_id) {
+					if (rec.type == TS_INDEX_PMT) {
+						pmts[i] = rec;
+					} else {
+						events[i] = rec;
+					}
+				}
+			}
+		}
+	}
+
+	init_set(set);
+	if (!got_pat) {
+		return;
+	}
+	for (i = 0; i < pat.n_items; i++) {
+		item.program_number = pat.items[i].id;
+		item.pid = pat.items[i].pid;
+		pat_handler(set, pat.n_items, i, &item);
+	}
+	for (i = 0; i < set->n_services; i++) {
+		pi = &set->proginfos[i];
+		if (pmts[i].type) {
+			pi->PCR_pid = pmts[i].pid;
+			pi->n_service_pids = pmts[i].n_items;
+			for (j = 0; j < pmts[i].n_items; j++) {
+				pi->service_pids[j].stream_type = pmts[i].items[j].id;
+				pi->service_pids[j].pid = pmts[i].items[j].pid;
+			}
+			pi->status |= PGINFO_GET_PMT;
+		}
+		if (events[i].type) {
+			pi->event_id = events[i].event_id;
+			pi->start = events[i].time;
+			if (events[i].unknown_start) {
+				pi->status |= PGINFO_UNKNOWN_STARTTIME;
+			}
+			pi->status |= PGINFO_GET_EVENT_INFO;
+		}
 	}
+	update_event_ids(set);
+	update_pcr_index(set);
+}
 
+static int wanted_event(int event_id)
+{
+	int k;
+	for (k = 0; k < n_outputs; k++) {
+		if (match_event(&outputs[k], event_id)) {
+			return 1;
+		}
+	}
 	return 0;
 }
 
-static int main_loop(FILE *fp_in, FILE *fp_out)
+/*
+	CfbNXw肳ꂽԑgĂ͈͂߂B
+	SĂ̏o͂event_idōiĂȂΑŜǂޕKv̂-1Ԃ
+*/
+static int index_ranges(int64_t **ranges)
 {
-	int i, n_in, n, c;
-	uint8_t buf[TS_PACKET_SIZE * 256], *buf_out, *p;
-	ts_header_t tsh;
+	int i, k, n = 0, cap = 0, active = 0, n_services = 0;
+	int sids[MAX_SERVICES_PER_CH], events[MAX_SERVICES_PER_CH];
+	int64_t start;
+	ts_index_record_t rec;
+
+	for (k = 0; k < n_outputs; k++) {
+		if (outputs[k].n_event_ids == 0) {
+			return -1;
+		}
+	}
+
+	*ranges = NULL;
+	ts_index_rewind(index_in);
+	while (ts_index_read(index_in, &rec)) {
+		if (rec.type != TS_INDEX_EVENT) {
+			continue;
+		}
+		for (i = 0; i < n_services && sids[i] != rec.service_id; i++);
+		if (i == n_services) {
+			if (n_services >= MAX_SERVICES_PER_CH) {
+				continue;
+			}
+			sids[n_services++] = rec.service_id;
+		}
+		events[i] = rec.event_id;
+
+		for (i = 0; i < n_services && !wanted_event(events[i]); i++);
+		if (!active && i < n_services) {
+			/*  */
+			start = rec.offset - INDEX_SEEK_MARGIN;
+			if (start < 0) {
+				start = 0;
+			}
+			if (n > 0 && start <= (*ranges)[n * 2 - 1]) {
+				/* O͈̔͂ƂȂ */
+				n--;
+				start = (*ranges)[n * 2];
+			}
+			if (n == cap) {
+				cap = cap ? cap * 2 : 8;
+				*ranges = (int64_t*)realloc(*ranges, sizeof(int64_t) * 2 * cap);
+			}
+			(*ranges)[n * 2] = start;
+			(*ranges)[n * 2 + 1] = -1;
+			n++;
+			active = 1;
+		} else if (active && i == n_services) {
+			/* ܂ */
+			(*ranges)[n * 2 - 1] = rec.offset + TS_PACKET_SIZE;
+			active = 0;
+		}
+	}
+	return n;
+}
+
+static void open_index(ts_input_t *input)
+{
+	FILE *fp;
+
+	fp = my_fopen(index_file, TSD_TEXT("rb"));
+	if (fp) {
+		index_in = ts_index_load(fp, ts_input_size(input));
+		fclose(fp);
+		if (index_in) {
+			my_fprintf(stderr, TSD_TEXT("index: %s\n"), index_file);
+			return;
+		}
+	}
+
+	/* gCfbNXΏȂ */
+	index_fp = my_fopen(index_file, TSD_TEXT("wb"));
+	if (index_fp) {
+		index_out = ts_index_create(index_fp);
+	}
+	if (!index_out) {
+		my_fprintf(stderr, TSD_TEXT("index file write error: %s\n"), index_file);
+		if (index_fp) {
+			fclose(index_fp);
+			index_fp = NULL;
+		}
+		return;
+	}
+	my_fprintf(stderr, TSD_TEXT("index (create): %s\n"), index_file);
+	memset(&index_state, 0, sizeof(index_state));
+	memset(index_state.event_ids, 0xff, sizeof(index_state.event_ids));
+	index_state.pcr_pid = -1;
+}
+
+static void close_index(int complete, int64_t input_size)
+{
+	if (index_out) {
+		if (complete && !ts_index_finish(index_out, input_size)) {
+			my_fprintf(stderr, TSD_TEXT("index file write error: %s\n"), index_file);
+		}
+		fclose(index_fp);
+		index_out = NULL;
+		index_fp = NULL;
+	}
+	if (index_in) {
+		ts_index_close(index_in);
+		index_in = NULL;
+	}
+}
+
+static int main_loop(FILE *fp_in)
+{
+	int i, n, k, ret, n_ranges = -1;
+	int64_t *ranges;
 	parse_set_t set;
-	int64_t in = 0, out = 0, t, last_print = 0;
 	ts_alignment_filter_t f;
+	ts_input_t input;
 
+	ts_input_open(&input, fp_in, io_flags);
+	if (index_file) {
+		open_index(&input);
+	}
+	if (index_out || epg) {
+		/* CfbNXԑg\Ƃ͍Ō܂œǂ */
+		early_stop = 0;
+	}
 	init_set(&set);
+	for (k = 0; k < n_outputs; k++) {
+		if (outputs[k].fp) {
+			ts_output_open(&outputs[k].output, outputs[k].fp, io_flags);
+		}
+	}
+	if (use_threads && use_splice) {
+		fprintf(stderr, "splice is not used with --threads\n");
+		use_splice = 0;
+	}
+	if ((n_outputs > 1 || outputs[0].split) && use_splice) {
+		fprintf(stderr, "splice is not used with multiple outputs\n");
+		use_splice = 0;
+	}
+	if (use_splice && !ts_splice_open(&input, &outputs[0].output)) {
+		fprintf(stderr, "splice is not available, fall back to stdio\n");
+		use_splice = 0;
+	}
 
-	if (sync) {
-		create_ts_alignment_filter(&f);
+	if (use_splice && !outputs[0].set_filter && !sync && !index_out && !epg) {
+		/* ƂȂ̂ŒgKvȂ */
+		while ((n = ts_splice_copy(&input, &outputs[0].output)) > 0) {
+			in_bytes += n;
+			out_bytes += n;
+			print_progress();
+		}
+		ts_output_close(&outputs[0].output);
+		close_index(0, 0);
+		ts_input_close(&input);
+		return n < 0;
 	}
 
-	while ((n_in = (int)fread(buf, TS_PACKET_SIZE, sizeof(buf)/TS_PACKET_SIZE, fp_in)) > 0) {
-		if (sync) {
-			ts_alignment_filter(&f, &buf_out, &n, buf, n_in * TS_PACKET_SIZE);
-			n /= TS_PACKET_SIZE;
+	if (index_in) {
+		if (use_threads || use_splice || !ts_input_seek(&input, 0)) {
+			fprintf(stderr, "index is not used because the input is not seekable\n");
+		} else if (epg) {
+			/* ԑg\ɂ͑ŜǂޕKv */
+			fprintf(stderr, "index is not used while building the EPG\n");
 		} else {
-			n = n_in;
-			buf_out = buf;
+			n_ranges = index_ranges(&ranges);
 		}
-		for (c = 0; c < n; c++) {
-			p = &buf_out[c * TS_PACKET_SIZE];
-			in++;
+	}
 
-			t = gettime();
-			if (t > last_print + 500) {
-				fprintf(stderr, "in: %10"PRId64", out: %10"PRId64"\r", in * TS_PACKET_SIZE, out * TS_PACKET_SIZE);
-				fflush(stderr);
-				last_print = t;
+	if (parallel_available(&input, n_ranges)) {
+		/* `NƂɕʁXɉ͂̂ŁAԑgIǂ͕Ȃ */
+		early_stop = 0;
+		ret = run_parallel(&input);
+		if (ret >= 0) {
+			if (ret) {
+				close_outputs();
+			} else {
+				ret = close_outputs();
 			}
+			close_index(0, 0);
+			ts_input_close(&input);
+			return ret;
+		}
+		fprintf(stderr, "failed to create threads, fall back to single thread\n");
+	}
 
-			if (!parse_ts_header(p, &tsh)) {
-				if (!set_filter) {
-					fwrite(p, TS_PACKET_SIZE, 1, fp_out);
-				}
-				continue;
+	if (use_threads) {
+		ret = run_pipeline(&input, &set);
+		if (ret >= 0) {
+			ret = close_outputs();
+			close_index(!ret, input.pos);
+			ts_input_close(&input);
+			return ret;
+		}
+		fprintf(stderr, "failed to create threads, fall back to single thread\n");
+	}
+
+	if (sync) {
+		create_ts_alignment_filter(&f);
+	}
+
+	if (n_ranges >= 0) {
+		/* CfbNXŕĂ͈͂ǂ */
+		ret = 0;
+		for (i = 0; i < n_ranges && !ret && !stop_reading; i++) {
+			ts_input_seek(&input, ranges[i * 2]);
+			seed_set(&set, ranges[i * 2]);
+			if (sync) {
+				reset_ts_alignment_filter(&f);
 			}
-			if (!tsh.transport_scrambling_control) {
-				if (set.n_services == 0) {
-					parse_PAT(&set.PAT, p, &tsh, &set, pat_handler);
-				} else {
-					for (i = 0; i < set.n_services; i++) {
-						parse_PMT(p, &tsh, &set.PMTs[i], &set.proginfos[i]);
+			ret = scan_input(&input, &set, sync ? &f : NULL, ranges[i * 2 + 1]);
+		}
+		free(ranges);
+	} else {
+		ret = scan_input(&input, &set, sync ? &f : NULL, -1);
+	}
+
+	if (ret) {
+		close_outputs();
+	} else {
+		ret = close_outputs();
+	}
+	close_index(!ret, input.pos);
+	ts_input_close(&input);
+	return ret;
+}
+
+static void write_epg_str(const uint8_t *aribstr, int len)
+{
+	int decoded = 0, str_len;
+	TSDCHAR str[256 * ARIB_CHAR_SIZE_RATIO], *c;
+
+	decode_aribstr(&decoded, str, sizeof(str) / sizeof(TSDCHAR), &str_len, aribstr, len);
+	for (c = str; *c != TSD_TEXT('\0'); c++) {
+		if (*c == TSD_TEXT('\t') || *c == TSD_TEXT('\r') || *c == TSD_TEXT('\n')) {
+			*c = TSD_TEXT(' ');
+		}
+	}
+	my_fprintf(epg_fp, TSD_TEXT("\t%s"), str);
+}
+
+/* 1s1ԑgA^u؂
+	original_network_id, transport_stream_id, service_id, event_id, Jn, (b), W, ԑg, ԑgTv */
+static int write_epg()
+{
+	int i, j, n, n_events = 0, genre;
+	const ts_epg_event_t *events, *ev;
+	const uint8_t *p, *end;
+	Sed_t sed;
+
+	for (i = 0; i < ts_epg_n_services(epg); i++) {
+		n = ts_epg_events(epg, i, &events);
+		for (j = 0; j < n; j++) {
+			ev = &events[j];
+			my_fprintf(epg_fp, TSD_TEXT("%d\t%d\t%d\t%d\t"),
+				ev->original_network_id, ev->transport_stream_id, ev->service_id, ev->event_id);
+			if (ev->unknown_start) {
+				my_fprintf(epg_fp, TSD_TEXT("-"));
+			} else {
+				my_fprintf(epg_fp, TSD_TEXT("%04d/%02d/%02d %02d:%02d:%02d"),
+					ev->start.year, ev->start.mon, ev->start.day, ev->start.hour, ev->start.min, ev->start.sec);
+			}
+
+			genre = -1;
+			sed.event_name_char = sed.text_char = NULL;
+			sed.event_name_length = sed.text_length = 0;
+			p = ev->desc;
+			end = &ev->desc[ev->desc_len];
+			while (end - p >= 2 && &p[2 + p[1]] <= end) {
+				if (p[0] == 0x4d) {
+					if (!parse_EIT_Sed(p, &sed)) {
+						sed.event_name_char = sed.text_char = NULL;
+						sed.event_name_length = sed.text_length = 0;
 					}
-					parse_EIT(&set.EIT0x12, p, &tsh, &set, find_curr_service_eit);
-					parse_EIT(&set.EIT0x26, p, &tsh, &set, find_curr_service_eit);
-					parse_EIT(&set.EIT0x27, p, &tsh, &set, find_curr_service_eit);
+				} else if (p[0] == 0x54 && p[1] >= 2 && genre < 0) {
+					genre = p[2];
 				}
+				p += 2 + p[1];
 			}
-			if (filter((int)tsh.pid, &set)) {
-				fwrite(p, TS_PACKET_SIZE, 1, fp_out);
-				out++;
+			my_fprintf(epg_fp, TSD_TEXT("\t%d\t"), ev->duration);
+			if (genre >= 0) {
+				my_fprintf(epg_fp, TSD_TEXT("%02x"), genre);
 			}
+			write_epg_str(sed.event_name_char, sed.event_name_length);
+			write_epg_str(sed.text_char, sed.text_length);
+			my_fprintf(epg_fp, TSD_TEXT("\n"));
 		}
+		n_events += n;
 	}
 
+	my_fprintf(stderr, TSD_TEXT("epg: %d services, %d events\n"), ts_epg_n_services(epg), n_events);
+	if (fclose(epg_fp) != 0) {
+		my_fprintf(stderr, TSD_TEXT("epg file write error: %s\n"), epg_file);
+		return 1;
+	}
 	return 0;
 }
 
+static void init_output_spec(output_spec_t *o)
+{
+	memset(o, 0, sizeof(output_spec_t));
+	o->split_event = -1;
+}
+
 #ifdef TSD_PLATFORM_MSVC
 int wmain
 #else
@@ -262,41 +1812,90 @@ int main
 #endif
 (int argc, const TSDCHAR *argv[])
 {
-	FILE *fp_in, *fp_out;
-	const TSDCHAR *arg, *in_file = NULL, *out_file = NULL;
-	int i, pid;
+	FILE *fp_in;
+	const TSDCHAR *arg, *in_file = NULL;
+	int i, k, pid, event_id, ret, use_stdout = 0;
+	output_spec_t *o = &outputs[0];
+
+	init_output_spec(o);
 
 	for (i = 1; i < argc; i++) {
 		arg = argv[i];
 		if (tsd_strncmp(arg, TSD_TEXT("event_id="), strlen("event_id=")) == 0) {
 			arg = &arg[strlen("event_id=")];
-			filter_event_id = tsd_atoi(arg);
-			if (0 <= filter_event_id && filter_event_id < 65536) {
-				set_filter = 1;
+			event_id = tsd_atoi(arg);
+			if (0 <= event_id && event_id < 65536) {
+				if (o->n_event_ids < MAX_EVENT_IDS) {
+					o->event_ids[o->n_event_ids++] = event_id;
+				}
+				o->set_filter = 1;
 			} else {
-				filter_event_id = -1;
-				fprintf(stderr, "Invalid event id: %d\n", filter_event_id);
+				fprintf(stderr, "Invalid event id: %d\n", event_id);
 			}
+		} else if (tsd_strncmp(arg, TSD_TEXT("split="), strlen("split=")) == 0) {
+			arg = &arg[strlen("split=")];
+			o->split = arg;
+			o->set_filter = 1;
+		} else if (tsd_strncmp(arg, TSD_TEXT("service_id="), strlen("service_id=")) == 0) {
+			arg = &arg[strlen("service_id=")];
+			if (o->n_service_ids < MAX_SERVICES_PER_CH) {
+				o->service_ids[o->n_service_ids++] = tsd_atoi(arg);
+				o->set_filter = 1;
+			}
+		} else if (tsd_strncmp(arg, TSD_TEXT("index="), strlen("index=")) == 0) {
+			index_file = &arg[strlen("index=")];
+		} else if (tsd_strncmp(arg, TSD_TEXT("epg="), strlen("epg=")) == 0) {
+			epg_file = &arg[strlen("epg=")];
 		} else if (tsd_strncmp(arg, TSD_TEXT("if="), strlen("if=")) == 0) {
 			arg = &arg[strlen("if=")];
 			in_file = arg;
 		} else if (tsd_strncmp(arg, TSD_TEXT("of="), strlen("of=")) == 0) {
 			arg = &arg[strlen("of=")];
-			out_file = arg;
+			o->file = arg;
+		} else if (tsd_strcmp(arg, TSD_TEXT("--")) == 0) {
+			/* ȍ~͎̏o͂̎w */
+			if (n_outputs >= MAX_OUTPUTS) {
+				fprintf(stderr, "Too many outputs (max %d)\n", MAX_OUTPUTS);
+				return 1;
+			}
+			o = &outputs[n_outputs++];
+			init_output_spec(o);
 		} else if (tsd_strcmp(arg, TSD_TEXT("pmt")) == 0) {
-			add_pat = 1;
-			set_filter = 1;
+			o->add_pat = 1;
+			o->set_filter = 1;
 		} else if (tsd_strcmp(arg, TSD_TEXT("pat")) == 0) {
-			add_pmt = 1;
-			set_filter = 1;
+			o->add_pmt = 1;
+			o->set_filter = 1;
 		} else if (tsd_strcmp(arg, TSD_TEXT("--nosync")) == 0) {
 			sync = 0;
+		} else if (tsd_strcmp(arg, TSD_TEXT("--nommap")) == 0) {
+			use_mmap = 0;
+		} else if (tsd_strcmp(arg, TSD_TEXT("--uring")) == 0) {
+			use_uring = 1;
+		} else if (tsd_strcmp(arg, TSD_TEXT("--splice")) == 0) {
+			use_splice = 1;
+		} else if (tsd_strcmp(arg, TSD_TEXT("--threads")) == 0) {
+			use_threads = 1;
+		} else if (tsd_strcmp(arg, TSD_TEXT("--strip")) == 0) {
+			strip_extra = 1;
+		} else if (tsd_strcmp(arg, TSD_TEXT("--nostop")) == 0) {
+			early_stop = 0;
+		} else if (tsd_strncmp(arg, TSD_TEXT("--stop-grace="), strlen("--stop-grace=")) == 0) {
+			stop_grace = tsd_atoi(&arg[strlen("--stop-grace=")]);
+			if (stop_grace < 0) {
+				stop_grace = 0;
+			}
+		} else if (tsd_strncmp(arg, TSD_TEXT("--parallel="), strlen("--parallel=")) == 0) {
+			n_parallel = tsd_atoi(&arg[strlen("--parallel=")]);
+			if (n_parallel > MAX_PARALLEL) {
+				n_parallel = MAX_PARALLEL;
+			}
 		} else {
-			if (n_filter_pids < sizeof(filter_pids) / sizeof(int)) {
+			if (o->n_pids < sizeof(o->pids) / sizeof(int)) {
 				pid = tsd_atoi(arg);
 				if (0 <= pid && pid <= 8192) {
-					filter_pids[n_filter_pids++] = pid;
-					set_filter = 1;
+					o->pids[o->n_pids++] = pid;
+					o->set_filter = 1;
 				} else {
 					fprintf(stderr, "Invalid PID: %d\n", pid);
 				}
@@ -319,22 +1918,54 @@ int main
 		my_fprintf(stderr, TSD_TEXT("input: <stdin>\n"));
 	}
 
-	if (out_file) {
-		fp_out = my_fopen(out_file, TSD_TEXT("wb"));
-		if (!fp_out) {
-			my_fprintf(stderr, TSD_TEXT("file open error: %s\n"), out_file);
-			return 1;
+	for (k = 0; k < n_outputs; k++) {
+		o = &outputs[k];
+		if (!o->set_filter) {
+			unfiltered_mask |= 1u << k;
 		}
-		my_fprintf(stderr, TSD_TEXT("output: %s\n"), out_file);
-	} else {
+		if (o->split) {
+			/* t@C͔ԑgĂJ */
+			continue;
+		} else if (o->file) {
+			o->fp = my_fopen(o->file, TSD_TEXT("wb"));
+			if (!o->fp) {
+				my_fprintf(stderr, TSD_TEXT("file open error: %s\n"), o->file);
+				return 1;
+			}
+			my_fprintf(stderr, TSD_TEXT("output: %s\n"), o->file);
+		} else if (!use_stdout) {
 #ifdef TSD_PLATFORM_MSVC
-		_setmode(_fileno(stdout), _O_BINARY);
+			_setmode(_fileno(stdout), _O_BINARY);
 #endif
-		fp_out = stdout;
-		my_fprintf(stderr, TSD_TEXT("output: <stdout>\n"));
+			o->fp = stdout;
+			use_stdout = 1;
+			my_fprintf(stderr, TSD_TEXT("output: <stdout>\n"));
+		} else {
+			fprintf(stderr, "Only one output can be written to stdout\n");
+			return 1;
+		}
+	}
+
+	if (epg_file) {
+		epg_fp = my_fopen(epg_file, TSD_TEXT("wb"));
+		if (!epg_fp) {
+			my_fprintf(stderr, TSD_TEXT("file open error: %s\n"), epg_file);
+			return 1;
+		}
+		my_fprintf(stderr, TSD_TEXT("epg: %s\n"), epg_file);
+		epg = ts_epg_create();
 	}
 
 	fflush(stderr);
 
-	return main_loop(fp_in, fp_out);
-}
\ No newline at end of file
+	io_flags = (use_mmap ? TS_IO_MMAP : 0) | (use_uring ? TS_IO_URING : 0);
+	ts_batch_init();
+	ret = main_loop(fp_in);
+	if (epg) {
+		if (write_epg()) {
+			ret = 1;
+		}
+		ts_epg_close(epg);
+	}
+	return ret;
+}
@@ -13,6 +13,7 @@ typedef uint32_t DWORD;
 #include "utils/arib_parser.h"
 #include "utils/tsdstr.h"
 #include "utils/aribstr.h"
+#include "utils/tsdcrc.h"
 #include "core/tsdump.h"
 
 #define TT TSD_TEXT
@@ -118,7 +119,17 @@ void get_genre_str(const TSDCHAR **genre1, const TSDCHAR **genre2, Cd_t_item ite
 	}
 }
 
-int get_extended_text(TSDCHAR *dst, size_t n, const proginfo_t *pi)
+/* fR[hȂfR[hĂԂ */
+const TSDCHAR *decode_aribstr(int *decoded, TSDCHAR *str, int str_size, int *str_len, const uint8_t *aribstr, int aribstr_len)
+{
+	if (!*decoded) {
+		*str_len = AribToString(str, str_size, aribstr, aribstr_len);
+		*decoded = 1;
+	}
+	return str;
+}
+
+int get_extended_text(TSDCHAR *dst, size_t n, proginfo_t *pi)
 {
 	int i;
 	TSDCHAR *p = dst, *end = &dst[n - 1];
@@ -129,11 +140,11 @@ int get_extended_text(TSDCHAR *dst, size_t n, const proginfo_t *pi)
 	}
 
 	for (i = 0; i < pi->n_items && p < end; i++) {
-		tsd_strlcpy(p, pi->items[i].desc.str, end - p);
+		tsd_strlcpy(p, get_aribstr(&pi->items[i].desc), end - p);
 		while (*p != L'\0') { p++; }
 		tsd_strlcpy(p, TSD_TEXT("\n"), end - p);
 		while (*p != L'\0') { p++; }
-		tsd_strlcpy(p, pi->items[i].item.str, end - p);
+		tsd_strlcpy(p, get_aribstr(&pi->items[i].item), end - p);
 		while (*p != L'\0') { p++; }
 		tsd_strlcpy(p, TSD_TEXT("\n"), end - p);
 		while (*p != L'\0') { p++; }
@@ -595,7 +606,7 @@ static inline void parse_PSI(const uint8_t *packet, const ts_header_t *tsh, PSI_
 
 	if (ps->stat == PAYLOAD_STAT_FINISHED) {
 		ps->crc32 = get_payload_crc32(ps);
-		uint32_t crc = crc32(ps->payload, ps->n_payload - 4);
+		uint32_t crc = tsd_crc32(ps->payload, ps->n_payload - 4);
 		if (ps->crc32 != crc) {
 			ps->stat = PAYLOAD_STAT_INIT;
 			output_message(MSG_PACKETERROR, TSD_TEXT("Payload CRC32 mismatch! (pid=0x%02x)"), ps->pid);
@@ -603,6 +614,27 @@ static inline void parse_PSI(const uint8_t *packet, const ts_header_t *tsh, PSI_
 	}
 }
 
+/* ZNV̐擪8oCgCRC环ʂ */
+static inline void get_section_key(const PSI_parse_t *ps, PSI_section_key_t *key)
+{
+	key->valid = 1;
+	key->table_id = ps->payload[0];
+	key->id = (uint16_t)get_bits(ps->payload, 24, 16);
+	key->version_number = (uint8_t)get_bits(ps->payload, 42, 5);
+	key->section_number = ps->payload[6];
+	key->crc32 = ps->crc32;
+}
+
+static inline int same_section(const PSI_section_key_t *k1, const PSI_section_key_t *k2)
+{
+	return k1->valid && k2->valid &&
+		k1->table_id == k2->table_id &&
+		k1->id == k2->id &&
+		k1->version_number == k2->version_number &&
+		k1->section_number == k2->section_number &&
+		k1->crc32 == k2->crc32;
+}
+
 void clear_proginfo_all(proginfo_t *proginfo)
 {
 	/* Œ̂̂I[NA */
@@ -616,6 +648,8 @@ void init_proginfo(proginfo_t *proginfo)
 {
 	proginfo->status = 0;
 	proginfo->last_desc = -1;
+	proginfo->last_PMT.valid = 0;
+	proginfo->last_EIT.valid = 0;
 	proginfo->PCR_base = 0;
 	proginfo->PCR_wraparounded = 0;
 }
@@ -689,47 +723,42 @@ int parse_EIT_Eed_item(const uint8_t *item, const uint8_t *item_end, Eed_item_t
 	return 1;
 }
 
-void parse_EIT_header(const uint8_t *payload, EIT_header_t *eit)
+int parse_EIT_header(bitstream_t *bs, EIT_header_t *eit)
 {
-	eit->table_id						= payload[0];
-	eit->section_syntax_indicator		= get_bits(payload, 8, 1);
-	eit->section_length					= get_bits(payload, 12, 12);
-	eit->service_id						= get_bits(payload, 24, 16);
-	eit->version_number					= get_bits(payload, 42, 5);
-	eit->current_next_indicator			= get_bits(payload, 47, 1);
-	eit->section_number					= get_bits(payload, 48, 8);
-	eit->last_section_number			= get_bits(payload, 56, 8);
-	eit->transport_stream_id			= get_bits(payload, 64, 16);
-	eit->original_network_id			= get_bits(payload, 80, 16);
-	eit->segment_last_section_number	= get_bits(payload, 96, 8);
-	eit->last_table_id					= get_bits(payload, 104, 8);
+	eit->table_id						= bs_read(bs, 8);
+	eit->section_syntax_indicator		= bs_read(bs, 1);
+	bs_skip(bs, 3);
+	eit->section_length					= bs_read(bs, 12);
+	eit->service_id						= bs_read(bs, 16);
+	bs_skip(bs, 2);
+	eit->version_number					= bs_read(bs, 5);
+	eit->current_next_indicator			= bs_read(bs, 1);
+	eit->section_number					= bs_read(bs, 8);
+	eit->last_section_number			= bs_read(bs, 8);
+	eit->transport_stream_id			= bs_read(bs, 16);
+	eit->original_network_id			= bs_read(bs, 16);
+	eit->segment_last_section_number	= bs_read(bs, 8);
+	eit->last_table_id					= bs_read(bs, 8);
+	return !bs->error;
 }
 
-void parse_EIT_body(const uint8_t *body, EIT_body_t *eit_b)
+/* 12oCgǂ */
+int parse_EIT_body(bitstream_t *bs, EIT_body_t *eit_b)
 {
-	eit_b->event_id						= get_bits(body, 0, 16);
-	eit_b->start_time_mjd				= get_bits(body, 16, 16);
-	eit_b->start_time_jtc				= get_bits(body, 32, 24);
-	eit_b->duration						= get_bits(body, 56, 24);
-	eit_b->running_status				= get_bits(body, 80, 3);
-	eit_b->free_CA_mode					= get_bits(body, 83, 1);
-	eit_b->descriptors_loop_length		= get_bits(body, 84, 12);
+	eit_b->event_id						= bs_read(bs, 16);
+	eit_b->start_time_mjd				= bs_read(bs, 16);
+	eit_b->start_time_jtc				= bs_read(bs, 24);
+	eit_b->duration						= bs_read(bs, 24);
+	eit_b->running_status				= bs_read(bs, 3);
+	eit_b->free_CA_mode					= bs_read(bs, 1);
+	eit_b->descriptors_loop_length		= bs_read(bs, 12);
+	return !bs->error;
 }
 
 void store_EIT_Sed(const Sed_t *sed, proginfo_t *proginfo)
 {
-	proginfo->event_name.aribstr_len = sed->event_name_length;
-	memcpy(proginfo->event_name.aribstr, sed->event_name_char, sed->event_name_length);
-	proginfo->event_text.aribstr_len = sed->text_length;
-	memcpy(proginfo->event_text.aribstr, sed->text_char, sed->text_length);
-
-	proginfo->event_name.str_len = 
-		AribToString(proginfo->event_name.str, sizeof(proginfo->event_name.str),
-					proginfo->event_name.aribstr, proginfo->event_name.aribstr_len);
-
-	proginfo->event_text.str_len =
-		AribToString(proginfo->event_text.str, sizeof(proginfo->event_text.str),
-			proginfo->event_text.aribstr, proginfo->event_text.aribstr_len);
+	set_aribstr(&proginfo->event_name, sed->event_name_char, (int)sed->event_name_length);
+	set_aribstr(&proginfo->event_text, sed->text_char, (int)sed->text_length);
 	proginfo->status |= PGINFO_GET_SHORT_TEXT;
 }
 
@@ -795,7 +824,6 @@ void store_EIT_body(const EIT_body_t *eit_b, proginfo_t *proginfo)
 
 void store_EIT_Eed_item(const Eed_t *eed, const Eed_item_t *eed_item, proginfo_t *proginfo)
 {
-	int i;
 	int item_len;
 	Eed_itemset_t *curr_item;
 
@@ -834,13 +862,8 @@ void store_EIT_Eed_item(const Eed_t *eed, const Eed_item_t *eed_item, proginfo_t
 		curr_item = &proginfo->items[proginfo->n_items];
 		if (proginfo->n_items < sizeof(proginfo->items) / sizeof(proginfo->items[0])) {
 			proginfo->n_items++;
-			if (eed_item->item_description_length <= sizeof(curr_item->desc.aribstr)) {
-				curr_item->desc.aribstr_len = eed_item->item_description_length;
-			} else {
-				/* TCYI[o[Ȃ̂Ő؂l߂ */
-				curr_item->desc.aribstr_len = sizeof(curr_item->desc.aribstr);
-			}
-			memcpy(curr_item->desc.aribstr, eed_item->item_description_char, eed_item->item_description_length);
+			/* TCYI[o[Ȃ؂l߂ */
+			set_aribstr(&curr_item->desc, eed_item->item_description_char, (int)eed_item->item_description_length);
 			curr_item->item.aribstr_len = 0;
 		} else {
 			/* ȏitemǉłȂ */
@@ -861,24 +884,11 @@ void store_EIT_Eed_item(const Eed_t *eed, const Eed_item_t *eed_item, proginfo_t
 		/* TCYI[o[Ȃ̂Ő؂l߂ */
 		item_len = sizeof(curr_item->item.aribstr);
 	}
-	memcpy(&curr_item->item.aribstr[curr_item->item.aribstr_len], eed_item->item_char, eed_item->item_length);
+	memcpy(&curr_item->item.aribstr[curr_item->item.aribstr_len], eed_item->item_char, item_len - curr_item->item.aribstr_len);
 	curr_item->item.aribstr_len = item_len;
+	curr_item->item.decoded = 0;
 
 	if (proginfo->curr_desc == proginfo->last_desc) {
-		for (i = 0; i < proginfo->n_items; i++) {
-			proginfo->items[i].desc.str_len = AribToString(
-					proginfo->items[i].desc.str,
-					sizeof(proginfo->items[i].desc.str),
-					proginfo->items[i].desc.aribstr,
-					proginfo->items[i].desc.aribstr_len
-				);
-			proginfo->items[i].item.str_len = AribToString(
-					proginfo->items[i].item.str,
-					sizeof(proginfo->items[i].item.str),
-					proginfo->items[i].item.aribstr,
-					proginfo->items[i].item.aribstr_len
-				);
-		}
 		proginfo->status |= PGINFO_GET_EXTEND_TEXT;
 	}
 }
@@ -902,7 +912,7 @@ void parse_EIT_Cd(const uint8_t *desc, Cd_t *cd)
 void parse_PCR(const uint8_t *packet, const ts_header_t *tsh, void *param, service_callback_handler_t handler)
 {
 	int wraparounded;
-	const uint8_t *p;
+	bitstream_t bs;
 	uint64_t PCR_base = 0;
 	int64_t offset;
 	unsigned int PCR_ext = 0;
@@ -912,8 +922,8 @@ void parse_PCR(const uint8_t *packet, const ts_header_t *tsh, void *param, servi
 		return;
 	}
 
-	p = &packet[tsh->adaptation_field_pos];
-	if ( !get_bits(p, 3, 1) ) {
+	bs_init(&bs, &packet[tsh->adaptation_field_pos], tsh->adaptation_field_len);
+	if ( !bs_get(&bs, 3, 1) ) {
 		/* no PCR */
 		return;
 	}
@@ -924,8 +934,11 @@ void parse_PCR(const uint8_t *packet, const ts_header_t *tsh, void *param, servi
 	}
 
 	if (tsh->pid == current_proginfo->PCR_pid) {
-		PCR_base = get_bits64(p, 8, 33);
-		PCR_ext = get_bits(p, 47, 9);
+		if (bs_left(&bs) < 56) {
+			return;
+		}
+		PCR_base = get_bits64(bs.buf, 8, 33);
+		PCR_ext = get_bits(bs.buf, 47, 9);
 		offset = (int64_t)PCR_base - (int64_t)current_proginfo->PCR_base;
 		wraparounded = 0;
 		if (offset < 0) {
@@ -968,14 +981,16 @@ void parse_TOT_TDT(const uint8_t *packet, const ts_header_t *tsh, PSI_parse_t *T
 	uint8_t tid;
 	uint32_t bcd_jst;
 	time_mjd_t TOT_time;
+	bitstream_t bs;
 
 	parse_PSI(packet, tsh, TOT_payload);
 	if (TOT_payload->stat != PAYLOAD_STAT_FINISHED || TOT_payload->n_payload < 8) {
 		return;
 	}
 
-	tid = TOT_payload->payload[0];
-	slen = get_bits(TOT_payload->payload, 12, 12);
+	bs_init(&bs, TOT_payload->payload, TOT_payload->n_payload);
+	tid = (uint8_t)bs_get(&bs, 0, 8);
+	slen = bs_get(&bs, 12, 12);
 	if (tid == 0x70) {
 		/* TDT */
 		if (slen != 5) {  return; }
@@ -984,8 +999,11 @@ void parse_TOT_TDT(const uint8_t *packet, const ts_header_t *tsh, PSI_parse_t *T
 		if (slen < 5) { return; }
 	} else { return; }
 
-	TOT_time.mjd = get_bits(TOT_payload->payload, 24, 16);
-	bcd_jst= get_bits(TOT_payload->payload, 40, 24);
+	TOT_time.mjd = bs_get(&bs, 24, 16);
+	bcd_jst = bs_get(&bs, 40, 24);
+	if (bs.error) {
+		return;
+	}
 
 	mjd_to_ymd(TOT_time.mjd, &TOT_time.year, &TOT_time.mon, &TOT_time.day);
 	TOT_time.hour = (bcd_jst >> 20 & 0x0f) * 10 + ((bcd_jst >> 16) & 0x0f);
@@ -998,42 +1016,51 @@ void parse_TOT_TDT(const uint8_t *packet, const ts_header_t *tsh, PSI_parse_t *T
 	handler(param, &TOT_time);
 }
 
-void parse_EIT(PSI_parse_t *payload_stat, const uint8_t *packet, const ts_header_t *tsh, void *param, eit_callback_handler_t handler)
+/* ԑgXV1Ԃ */
+int parse_EIT(PSI_parse_t *payload_stat, const uint8_t *packet, const ts_header_t *tsh, void *param, eit_callback_handler_t handler)
 {
-	int len;
 	EIT_header_t eit_h;
 	EIT_body_t eit_b;
-	uint8_t *p_eit_b, *p_eit_end;
-	uint8_t *p_desc, *p_desc_end;
+	PSI_section_key_t key;
+	bitstream_t bs;
+	const uint8_t *p_desc, *p_desc_end;
 	uint8_t dtag, dlen;
 	proginfo_t *curr_proginfo;
 
 	parse_PSI(packet, tsh, payload_stat);
 
 	if (payload_stat->stat != PAYLOAD_STAT_FINISHED || payload_stat->payload[0] != 0x4e) {
-		return;
+		return 0;
 	}
 
-	parse_EIT_header(payload_stat->payload, &eit_h);
+	bs_init(&bs, payload_stat->payload, payload_stat->n_payload - 4/*=sizeof(crc32)*/);
+	if (!parse_EIT_header(&bs, &eit_h)) {
+		return 0;
+	}
 
 	/* R[obN֐ĂсA擾Ώۂ̔ԑg񂩂ǂ`FbN */
 	curr_proginfo = handler(param, &eit_h);
 	if(!curr_proginfo) {
-		return;
+		return 0;
+	}
+
+	/* O񂱂̔ԑgɔf̂ƓZNV̍đȂ牽ςȂ */
+	get_section_key(payload_stat, &key);
+	if (same_section(&key, &curr_proginfo->last_EIT)) {
+		return 0;
 	}
+	curr_proginfo->last_EIT = key;
 
-	len = payload_stat->n_payload - 14 - 4/*=sizeof(crc32)*/;
-	p_eit_b = &payload_stat->payload[14];
-	p_eit_end = &p_eit_b[len];
-	while(&p_eit_b[12] < p_eit_end) {
-		parse_EIT_body(p_eit_b, &eit_b); /* read 12bytes */
+	while (bs_left(&bs) > 12 * 8) {
+		parse_EIT_body(&bs, &eit_b); /* read 12bytes */
 		store_EIT_body(&eit_b, curr_proginfo);
 
-		p_desc = &p_eit_b[12];
-		p_desc_end = &p_desc[eit_b.descriptors_loop_length];
-		if (p_desc_end > p_eit_end) {
+		if (bs_left(&bs) < (int)eit_b.descriptors_loop_length * 8) {
 			break;
 		}
+		p_desc = bs_ptr(&bs);
+		p_desc_end = &p_desc[eit_b.descriptors_loop_length];
+		bs_skip(&bs, eit_b.descriptors_loop_length * 8);
 
 		while( p_desc < p_desc_end ) {
 			dtag = p_desc[0];
@@ -1053,7 +1080,7 @@ void parse_EIT(PSI_parse_t *payload_stat, const uint8_t *packet, const ts_header
 			} else if (dtag == 0x4e) {
 				Eed_t eed;
 				Eed_item_t eed_item;
-				uint8_t *p_eed_item, *p_eed_item_end;
+				const uint8_t *p_eed_item, *p_eed_item_end;
 				if (parse_EIT_Eed(p_desc, &eed)) {
 					p_eed_item = &p_desc[7];
 					p_eed_item_end = &p_eed_item[eed.length_of_items];
@@ -1076,8 +1103,8 @@ void parse_EIT(PSI_parse_t *payload_stat, const uint8_t *packet, const ts_header
 
 			p_desc += (2+dlen);
 		}
-		p_eit_b = p_desc_end;
 	}
+	return 1;
 }
 
 int parse_SDT_Sd(const uint8_t *desc, Sd_t *sd)
@@ -1102,28 +1129,35 @@ int parse_SDT_Sd(const uint8_t *desc, Sd_t *sd)
 	return 1;
 }
 
-void parse_SDT_header(const uint8_t *payload, SDT_header_t *sdt_h)
+int parse_SDT_header(bitstream_t *bs, SDT_header_t *sdt_h)
 {
-	sdt_h->table_id						= payload[0];
-	sdt_h->section_syntax_indicator 	= get_bits(payload,  8,  1);
-	sdt_h->section_length 				= get_bits(payload, 12, 12);
-	sdt_h->transport_stream_id 			= get_bits(payload, 24, 16);
-	sdt_h->version_number 				= get_bits(payload, 42,  5);
-	sdt_h->current_next_indicator 		= get_bits(payload, 47,  1);
-	sdt_h->section_number 				= get_bits(payload, 48,  8);
-	sdt_h->last_section_number 			= get_bits(payload, 56,  8);
-	sdt_h->original_network_id 			= get_bits(payload, 64, 16);
+	sdt_h->table_id						= bs_read(bs, 8);
+	sdt_h->section_syntax_indicator 	= bs_read(bs, 1);
+	bs_skip(bs, 3);
+	sdt_h->section_length 				= bs_read(bs, 12);
+	sdt_h->transport_stream_id 			= bs_read(bs, 16);
+	bs_skip(bs, 2);
+	sdt_h->version_number 				= bs_read(bs, 5);
+	sdt_h->current_next_indicator 		= bs_read(bs, 1);
+	sdt_h->section_number 				= bs_read(bs, 8);
+	sdt_h->last_section_number 			= bs_read(bs, 8);
+	sdt_h->original_network_id 			= bs_read(bs, 16);
+	bs_skip(bs, 8);
+	return !bs->error;
 }
 
-void parse_SDT_body(const uint8_t *body, SDT_body_t *sdt_b)
+/* 5oCgǂ */
+int parse_SDT_body(bitstream_t *bs, SDT_body_t *sdt_b)
 {
-	sdt_b->service_id					= get_bits(body,  0, 16);
-	sdt_b->EIT_user_defined_flags		= get_bits(body, 19,  3);
-	sdt_b->EIT_schedule_flag			= get_bits(body, 22,  1);
-	sdt_b->EIT_present_following_flag	= get_bits(body, 23,  1);
-	sdt_b->running_status				= get_bits(body, 24,  3);
-	sdt_b->free_CA_mode					= get_bits(body, 27,  1);
-	sdt_b->descriptors_loop_length 		= get_bits(body, 28, 12);
+	sdt_b->service_id					= bs_read(bs, 16);
+	bs_skip(bs, 3);
+	sdt_b->EIT_user_defined_flags		= bs_read(bs, 3);
+	sdt_b->EIT_schedule_flag			= bs_read(bs, 1);
+	sdt_b->EIT_present_following_flag	= bs_read(bs, 1);
+	sdt_b->running_status				= bs_read(bs, 3);
+	sdt_b->free_CA_mode					= bs_read(bs, 1);
+	sdt_b->descriptors_loop_length 		= bs_read(bs, 12);
+	return !bs->error;
 }
 
 void store_SDT(const SDT_header_t *sdt_h, const Sd_t *sd, proginfo_t *proginfo)
@@ -1131,30 +1165,19 @@ void store_SDT(const SDT_header_t *sdt_h, const Sd_t *sd, proginfo_t *proginfo)
 	proginfo->network_id = sdt_h->original_network_id;
 	proginfo->ts_id = sdt_h->transport_stream_id;
 
-	proginfo->service_name.aribstr_len = sd->service_name_length;
-	memcpy(proginfo->service_name.aribstr, sd->service_name_char, sd->service_name_length);
-	proginfo->service_provider_name.aribstr_len = sd->service_provider_name_length;
-	memcpy(proginfo->service_provider_name.aribstr, sd->service_provider_name_char, sd->service_provider_name_length);
-
-	proginfo->service_name.str_len =
-		AribToString(proginfo->service_name.str, sizeof(proginfo->service_name.str),
-			proginfo->service_name.aribstr, proginfo->service_name.aribstr_len);
-
-	proginfo->service_provider_name.str_len =
-		AribToString(proginfo->service_provider_name.str, sizeof(proginfo->service_provider_name.str),
-			proginfo->service_provider_name.aribstr, proginfo->service_provider_name.aribstr_len);
+	set_aribstr(&proginfo->service_name, sd->service_name_char, (int)sd->service_name_length);
+	set_aribstr(&proginfo->service_provider_name, sd->service_provider_name_char, (int)sd->service_provider_name_length);
 
 	proginfo->status |= PGINFO_GET_SERVICE_INFO;
 }
 
 void parse_SDT(PSI_parse_t *payload_stat, const uint8_t *packet, const ts_header_t *tsh, void *param, service_callback_handler_t handler)
 {
-	int len;
 	SDT_header_t sdt_h;
 	SDT_body_t sdt_b;
 	Sd_t sd;
-	uint8_t *p_sdt_b, *p_sdt_end;
-	uint8_t *p_desc, *p_desc_end;
+	bitstream_t bs;
+	const uint8_t *p_desc, *p_desc_end;
 	uint8_t dtag, dlen;
 	proginfo_t *curr_proginfo;
 
@@ -1164,19 +1187,20 @@ void parse_SDT(PSI_parse_t *payload_stat, const uint8_t *packet, const ts_header
 		return;
 	}
 
-	parse_SDT_header(payload_stat->payload, &sdt_h);
+	bs_init(&bs, payload_stat->payload, payload_stat->n_payload - 4/*=sizeof(crc32)*/);
+	if (!parse_SDT_header(&bs, &sdt_h)) {
+		return;
+	}
 
-	len = payload_stat->n_payload - 11 - 4/*=sizeof(crc32)*/;
-	p_sdt_b = &payload_stat->payload[11];
-	p_sdt_end = &p_sdt_b[len];
-	while(&p_sdt_b[5] < p_sdt_end) {
-		parse_SDT_body(p_sdt_b, &sdt_b); /* read 5bytes */
+	while (bs_left(&bs) > 5 * 8) {
+		parse_SDT_body(&bs, &sdt_b); /* read 5bytes */
 
-		p_desc = &p_sdt_b[5];
-		p_desc_end = &p_desc[sdt_b.descriptors_loop_length];
-		if (p_desc_end > p_sdt_end) {
+		if (bs_left(&bs) < (int)sdt_b.descriptors_loop_length * 8) {
 			break;
 		}
+		p_desc = bs_ptr(&bs);
+		p_desc_end = &p_desc[sdt_b.descriptors_loop_length];
+		bs_skip(&bs, sdt_b.descriptors_loop_length * 8);
 
 		/* Ώۂ̃T[rXIDǂ */
 		curr_proginfo = handler(param, sdt_b.service_id);
@@ -1192,37 +1216,52 @@ void parse_SDT(PSI_parse_t *payload_stat, const uint8_t *packet, const ts_header
 				p_desc += (2+dlen);
 			}
 		}
-		p_sdt_b = p_desc_end;
 	}
 }
 
 /* PMT: ISO 13818-1 2.4.4.8 Program Map Table */
 void parse_PMT(const uint8_t *packet, const ts_header_t *tsh, PSI_parse_t *PMT_payload, proginfo_t *proginfo)
 {
-	int pos, n_pids, len;
+	int n_pids, es_info_length;
 	uint16_t pid;
 	uint8_t stream_type;
-	uint8_t *payload;
+	PSI_section_key_t key;
+	bitstream_t bs;
 
 	parse_PSI(packet, tsh, PMT_payload);
 	if (PMT_payload->stat != PAYLOAD_STAT_FINISHED) {
 		return;
 	}
 
-	len = PMT_payload->n_payload - 4/*crc32*/;
-	payload = PMT_payload->payload;
-	proginfo->PCR_pid = get_bits(payload, 67, 13);
-	pos = 12 + get_bits(payload, 84, 12);
+	get_section_key(PMT_payload, &key);
+	if ((proginfo->status & PGINFO_GET_PMT) && same_section(&key, &proginfo->last_PMT)) {
+		PMT_payload->stat = PAYLOAD_STAT_INIT;
+		return;
+	}
+
+	bs_init(&bs, PMT_payload->payload, PMT_payload->n_payload - 4/*crc32*/);
+	pid = (uint16_t)bs_get(&bs, 67, 13);
+	bs_seek(&bs, (12 + bs_get(&bs, 84, 12)) * 8);
+	if (bs.error) {
+		PMT_payload->stat = PAYLOAD_STAT_INIT;
+		return;
+	}
+	proginfo->PCR_pid = pid;
 	n_pids = 0;
-	while ( pos < len && n_pids <= MAX_PIDS_PER_SERVICE ) {
-		stream_type = payload[pos];
-		pid = (uint16_t)get_bits(payload, pos*8+11, 13);
-		pos += get_bits(payload, pos*8+28, 12) + 5;
+	/* 1ES̏5oCg */
+	while ( bs_left(&bs) >= 5 * 8 && n_pids < MAX_PIDS_PER_SERVICE ) {
+		stream_type = (uint8_t)bs_read(&bs, 8);
+		bs_skip(&bs, 3);
+		pid = (uint16_t)bs_read(&bs, 13);
+		bs_skip(&bs, 4);
+		es_info_length = bs_read(&bs, 12);
+		bs_skip(&bs, es_info_length * 8);
 		proginfo->service_pids[n_pids].stream_type = stream_type;
 		proginfo->service_pids[n_pids].pid = pid;
 		n_pids++;
 	}
 	proginfo->n_service_pids = n_pids;
+	proginfo->last_PMT = key;
 	PMT_payload->stat = PAYLOAD_STAT_INIT;
 	proginfo->status |= PGINFO_GET_PMT;
 }
@@ -1231,15 +1270,22 @@ void parse_PAT(PSI_parse_t *PAT_payload, const uint8_t *packet, const ts_header_
 {
 	int i, n;
 	PAT_item_t pat_item;
-	uint8_t *payload;
+	PSI_section_key_t key;
+	bitstream_t bs;
 
 	parse_PSI(packet, tsh, PAT_payload);
 	if (PAT_payload->stat == PAYLOAD_STAT_FINISHED) {
-		n = (PAT_payload->n_payload - 4/*crc32*/ - 8/*fixed length*/) / 4;
-		payload = &(PAT_payload->payload[8]);
+		get_section_key(PAT_payload, &key);
+		if (same_section(&key, &PAT_payload->last_section)) {
+			return;
+		}
+		PAT_payload->last_section = key;
+		bs_init(&bs, &PAT_payload->payload[8], PAT_payload->n_payload - 4/*crc32*/ - 8/*fixed length*/);
+		n = bs_left(&bs) / 32;
 		for (i = 0; i < n; i++) {
-			pat_item.program_number = get_bits(payload, i * 32, 16);
-			pat_item.pid = get_bits(payload, i * 32 + 19, 13);
+			pat_item.program_number = bs_read(&bs, 16);
+			bs_skip(&bs, 3);
+			pat_item.pid = bs_read(&bs, 13);
 			handler(param, n, i, &pat_item);
 		}
 	}
@@ -37,6 +37,16 @@ typedef enum {
 	PAYLOAD_STAT_FINISHED
 } PSI_stat_t;
 
+/* ͂ZNV̎ʁB̂đĂ͂Ȃ */
+typedef struct {
+	int valid;
+	uint8_t table_id;
+	uint8_t section_number;
+	uint8_t version_number;
+	uint16_t id; /* service_id, program_number, transport_stream_idȂ */
+	uint32_t crc32;
+} PSI_section_key_t;
+
 typedef struct {
 	unsigned int pid;
 	PSI_stat_t stat;
@@ -48,11 +58,14 @@ typedef struct {
 	int recv_payload;
 	unsigned int continuity_counter;
 	uint32_t crc32;
+	PSI_section_key_t last_section;
 } PSI_parse_t;
 
+/* strget_aribstr()ŕKvɂȂƂɃfR[hBdecoded0Ȃstr, str_len͖ */
 typedef struct {
 	int aribstr_len;
 	uint8_t aribstr[256];
+	int decoded;
 	int str_len;
 	TSDCHAR str[256*ARIB_CHAR_SIZE_RATIO];
 } Sed_string_t;
@@ -73,6 +86,7 @@ typedef struct {
 typedef struct {
 	int aribstr_len;
 	uint8_t aribstr[20]; /* ARIB TR-B14ɂď16bytesƒ߂Ă */
+	int decoded;
 	int str_len;
 	TSDCHAR str[20*ARIB_CHAR_SIZE_RATIO+1];
 } Eed_desc_t;
@@ -80,6 +94,7 @@ typedef struct {
 typedef struct {
 	int aribstr_len;
 	uint8_t aribstr[480]; /* ARIB TR-B14ɂď440bytesƒ߂Ă */
+	int decoded;
 	int str_len;
 	TSDCHAR str[480*ARIB_CHAR_SIZE_RATIO+1];
 } Eed_text_t;
@@ -133,7 +148,7 @@ typedef struct {
 
 	/***** PAT,PMT *****/
 	//PSI_parse_t PMT_payload;
-	//uint32_t PMT_last_CRC;
+	PSI_section_key_t last_PMT;
 	int n_service_pids;
 	PMT_pid_def_t service_pids[MAX_PIDS_PER_SERVICE];
 	unsigned int service_id : 16;
@@ -162,6 +177,7 @@ typedef struct {
 
 	int curr_desc;
 	int last_desc;
+	PSI_section_key_t last_EIT;
 
 	time_mjd_t start;
 	time_offset_t dur;
@@ -180,10 +196,16 @@ typedef struct {
 
 } proginfo_t;
 
-int get_extended_text(TSDCHAR *dst, size_t n, const proginfo_t *pi);
+const TSDCHAR *decode_aribstr(int *decoded, TSDCHAR *str, int str_size, int *str_len, const uint8_t *aribstr, int aribstr_len);
+#define get_aribstr(x) decode_aribstr(&(x)->decoded, (x)->str, sizeof((x)->str) / sizeof(TSDCHAR), &(x)->str_len, (x)->aribstr, (x)->aribstr_len)
+#define set_aribstr(x, src, len) ( (x)->aribstr_len = (len) < (int)sizeof((x)->aribstr) ? (len) : (int)sizeof((x)->aribstr), \
+	memcpy((x)->aribstr, (src), (x)->aribstr_len), (x)->decoded = 0 )
+
+int get_extended_text(TSDCHAR *dst, size_t n, proginfo_t *pi);
 void get_genre_str(const TSDCHAR **genre1, const TSDCHAR **genre2, Cd_t_item item);
 int proginfo_cmp(const proginfo_t *pi1, const proginfo_t *pi2);
 int get_stream_timestamp(const proginfo_t *pi, time_mjd_t *jst_time);
 int get_stream_timestamp_rough(const proginfo_t *pi, time_mjd_t *time_mjd);
 int get_time_offset(time_offset_t *offset, const time_mjd_t *time_target, const time_mjd_t *time_orig);
 void time_add_offset(time_mjd_t *dst, const time_mjd_t *orig, const time_offset_t *offset);
+void mjd_to_ymd(const unsigned int mjd16, int *year, int *mon, int *day);
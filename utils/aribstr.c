@@ -23,11 +23,13 @@ epgdumpライセンス(Solaris版より引用) :
 #include <wchar.h>
 #else
 #include <unistd.h>
-#include <iconv.h>
 #endif
 
 #include "utils/tsdstr.h"
 #include "utils/aribstr.h"
+#ifndef TSD_PLATFORM_MSVC
+#include "utils/jisx0208.h"
+#endif
 
 #define CODE_UNKNOWN 		0	// 不明なグラフィックセット(非対応)
 #define CODE_KANJI 		1	// Kanji
@@ -56,17 +58,34 @@ epgdumpライセンス(Solaris版より引用) :
 #define _T(a) TSD_TEXT(a)
 #define CODE_SET int
 
-static int m_CodeG[4];
-static int *m_pLockingGL;
-static int *m_pLockingGR;
-static int *m_pSingleGL;
+typedef enum{
+	STR_SMALL = 0,	//SSZ
+	STR_MEDIUM,		//MSZ
+	STR_NORMAL,		//NSZ
+	STR_MICRO,		//SZX 0x60
+	STR_HIGH_W,		//SZX 0x41
+	STR_WIDTH_W,	//SZX 0x44
+	STR_W,			//SZX 0x45
+	STR_SPECIAL_1,	//SZX 0x6B
+	STR_SPECIAL_2,	//SZX 0x64
+} STRING_SIZE;
+
+/* デコードの状態。AribToString()の呼び出しごとに持つので複数のスレッドから呼べる */
+typedef struct {
+	int m_CodeG[4];
+	int *m_pLockingGL;
+	int *m_pLockingGR;
+	int *m_pSingleGL;
 
-static	BYTE m_byEscSeqCount;
-static	BYTE m_byEscSeqIndex;
-static	bool m_bIsEscSeqDrcs;
+	BYTE m_byEscSeqCount;
+	BYTE m_byEscSeqIndex;
+	bool m_bIsEscSeqDrcs;
 
-static  const DWORD AribToStringInternal(TSDCHAR *lpszDst, const int dst_maxlen, const uint8_t *pSrcData, const int dwSrcLen);
-static	const DWORD ProcessCharCode(TSDCHAR *lpszDst, const WORD wCode, const CODE_SET CodeSet);
+	STRING_SIZE m_emStrSize;
+} arib_decoder_t;
+
+static  const DWORD AribToStringInternal(arib_decoder_t *ctx, TSDCHAR *lpszDst, const int dst_maxlen, const uint8_t *pSrcData, const int dwSrcLen);
+static	const DWORD ProcessCharCode(arib_decoder_t *ctx, TSDCHAR *lpszDst, const WORD wCode, const CODE_SET CodeSet);
 
 static	const DWORD PutKanjiChar(TSDCHAR *lpszDst, const WORD wCode);
 static	const DWORD PutAlphanumericChar(TSDCHAR *lpszDst, const WORD wCode);
@@ -76,14 +95,14 @@ static	const DWORD PutKatakanaChar(TSDCHAR *lpszDst, const WORD wCode);
 static	const DWORD PutJisKatakanaChar(TSDCHAR *lpszDst, const WORD wCode);
 static	const DWORD PutSymbolsChar(TSDCHAR *lpszDst, const WORD wCode);
 
-static	void ProcessEscapeSeq(const BYTE byCode);
+static	void ProcessEscapeSeq(arib_decoder_t *ctx, const BYTE byCode);
 
-static	void LockingShiftGL(const BYTE byIndexG);
-static	void LockingShiftGR(const BYTE byIndexG);
-static	void SingleShiftGL(const BYTE byIndexG);
+static	void LockingShiftGL(arib_decoder_t *ctx, const BYTE byIndexG);
+static	void LockingShiftGR(arib_decoder_t *ctx, const BYTE byIndexG);
+static	void SingleShiftGL(arib_decoder_t *ctx, const BYTE byIndexG);
 
-static	const bool DesignationGSET(const BYTE byIndexG, const BYTE byCode);
-static	const bool DesignationDRCS(const BYTE byIndexG, const BYTE byCode);
+static	const bool DesignationGSET(arib_decoder_t *ctx, const BYTE byIndexG, const BYTE byCode);
+static	const bool DesignationDRCS(arib_decoder_t *ctx, const BYTE byIndexG, const BYTE byCode);
 
 static const bool abCharSizeTable[] =
 {
@@ -105,24 +124,10 @@ static const bool abCharSizeTable[] =
 	true	// CODE_ADDITIONAL_SYMBOLS		Additional symbols
 };
 
-typedef enum{
-	STR_SMALL = 0,	//SSZ
-	STR_MEDIUM,		//MSZ
-	STR_NORMAL,		//NSZ
-	STR_MICRO,		//SZX 0x60
-	STR_HIGH_W,		//SZX 0x41
-	STR_WIDTH_W,	//SZX 0x44
-	STR_W,			//SZX 0x45
-	STR_SPECIAL_1,	//SZX 0x6B
-	STR_SPECIAL_2,	//SZX 0x64
-} STRING_SIZE;
-
-STRING_SIZE m_emStrSize;
-
-bool IsSmallCharMode(void)
+static bool IsSmallCharMode(const arib_decoder_t *ctx)
 {
 	bool bRet = false;
-	switch(m_emStrSize){
+	switch(ctx->m_emStrSize){
 		case STR_SMALL:
 			bRet = true;
 			break;
@@ -162,12 +167,12 @@ int AribToString(
 	const uint8_t *src,
 	const int src_len )
 {
-  
-	return AribToStringInternal(dst, dst_maxlen, src, src_len);
+	arib_decoder_t ctx;
+	return AribToStringInternal(&ctx, dst, dst_maxlen, src, src_len);
 }
 
 
-const DWORD AribToStringInternal(TSDCHAR *lpszDst, const int dst_maxlen,
+const DWORD AribToStringInternal(arib_decoder_t *ctx, TSDCHAR *lpszDst, const int dst_maxlen,
 								 const uint8_t *pSrcData, const int dwSrcLen)
 {
 	if (dwSrcLen <= 0 && dst_maxlen >= 1) {
@@ -180,70 +185,70 @@ const DWORD AribToStringInternal(TSDCHAR *lpszDst, const int dst_maxlen,
 	DWORD dwDstLen = 0UL;
 	int   dwSrcData;
 
-	TSDCHAR charbuf[8];
+	TSDCHAR charbuf[32]; /* 追加記号には長い代替文字列がある */
 	int charlen;
 	
 	// 状態初期設定
-	m_byEscSeqCount = 0U;
-	m_pSingleGL = NULL;
+	ctx->m_byEscSeqCount = 0U;
+	ctx->m_pSingleGL = NULL;
 
-	m_CodeG[0] = CODE_KANJI;
-	m_CodeG[1] = CODE_ALPHANUMERIC;
-	m_CodeG[2] = CODE_HIRAGANA;
-	m_CodeG[3] = CODE_KATAKANA;
+	ctx->m_CodeG[0] = CODE_KANJI;
+	ctx->m_CodeG[1] = CODE_ALPHANUMERIC;
+	ctx->m_CodeG[2] = CODE_HIRAGANA;
+	ctx->m_CodeG[3] = CODE_KATAKANA;
 
-	m_pLockingGL = &m_CodeG[0];
-	m_pLockingGR = &m_CodeG[2];
+	ctx->m_pLockingGL = &ctx->m_CodeG[0];
+	ctx->m_pLockingGR = &ctx->m_CodeG[2];
 
-	m_emStrSize = STR_NORMAL;
+	ctx->m_emStrSize = STR_NORMAL;
 
 	while(dwSrcPos < dwSrcLen){
 		dwSrcData = pSrcData[dwSrcPos] & 0xFF;
 		charlen = 0;
 
-		if(!m_byEscSeqCount){
+		if(!ctx->m_byEscSeqCount){
       
 			// GL/GR領域
 			if((dwSrcData >= 0x21U) && (dwSrcData <= 0x7EU)){
 				// GL領域
-				const CODE_SET CurCodeSet = (m_pSingleGL)? *m_pSingleGL : *m_pLockingGL;
-				m_pSingleGL = NULL;
+				const CODE_SET CurCodeSet = (ctx->m_pSingleGL)? *ctx->m_pSingleGL : *ctx->m_pLockingGL;
+				ctx->m_pSingleGL = NULL;
 				
 				if(abCharSizeTable[CurCodeSet]){
 					// 2バイトコード
-					charlen = ProcessCharCode(charbuf, ((WORD)pSrcData[dwSrcPos + 0] << 8) | (WORD)pSrcData[dwSrcPos + 1], CurCodeSet);
+					charlen = ProcessCharCode(ctx, charbuf, ((WORD)pSrcData[dwSrcPos + 0] << 8) | (WORD)pSrcData[dwSrcPos + 1], CurCodeSet);
 					dwSrcPos++;
 				} else{
 					// 1バイトコード
-					charlen = ProcessCharCode(charbuf, (WORD)dwSrcData, CurCodeSet);
+					charlen = ProcessCharCode(ctx, charbuf, (WORD)dwSrcData, CurCodeSet);
 				}
 			} else if((dwSrcData >= 0xA1U) && (dwSrcData <= 0xFEU)){
 				// GR領域
-				const CODE_SET CurCodeSet = *m_pLockingGR;
+				const CODE_SET CurCodeSet = *ctx->m_pLockingGR;
 				
 				if(abCharSizeTable[CurCodeSet]){
 					// 2バイトコード
-					charlen = ProcessCharCode(charbuf, ((WORD)(pSrcData[dwSrcPos + 0] & 0x7FU) << 8) | (WORD)(pSrcData[dwSrcPos + 1] & 0x7FU), CurCodeSet);
+					charlen = ProcessCharCode(ctx, charbuf, ((WORD)(pSrcData[dwSrcPos + 0] & 0x7FU) << 8) | (WORD)(pSrcData[dwSrcPos + 1] & 0x7FU), CurCodeSet);
 					dwSrcPos++;
 				} else{
 					// 1バイトコード
-					charlen = ProcessCharCode(charbuf, (WORD)(dwSrcData & 0x7FU), CurCodeSet);
+					charlen = ProcessCharCode(ctx, charbuf, (WORD)(dwSrcData & 0x7FU), CurCodeSet);
 				}
 			} else{
 				// 制御コード
 				switch(dwSrcData){
-				case 0x0FU	: LockingShiftGL(0U);				break;	// LS0
-				case 0x0EU	: LockingShiftGL(1U);				break;	// LS1
-				case 0x19U	: SingleShiftGL(2U);				break;	// SS2
-				case 0x1DU	: SingleShiftGL(3U);				break;	// SS3
-				case 0x1BU	: m_byEscSeqCount = 1U;				break;	// ESC
-				case 0x89U	: m_emStrSize = STR_MEDIUM;			break;	// MSZ
-				case 0x8AU	: m_emStrSize = STR_NORMAL;			break;	// NSZ
+				case 0x0FU	: LockingShiftGL(ctx, 0U);				break;	// LS0
+				case 0x0EU	: LockingShiftGL(ctx, 1U);				break;	// LS1
+				case 0x19U	: SingleShiftGL(ctx, 2U);				break;	// SS2
+				case 0x1DU	: SingleShiftGL(ctx, 3U);				break;	// SS3
+				case 0x1BU	: ctx->m_byEscSeqCount = 1U;				break;	// ESC
+				case 0x89U	: ctx->m_emStrSize = STR_MEDIUM;			break;	// MSZ
+				case 0x8AU	: ctx->m_emStrSize = STR_NORMAL;			break;	// NSZ
 				case 0x20U	:
 				case 0xA0U	:
 					//SP 空白
 					//空白は文字サイズの影響あり
-					if( IsSmallCharMode() == false ){
+					if( IsSmallCharMode(ctx) == false ){
 						tsd_strcpy(&lpszDst[dwDstLen], TSD_TEXT("　"));
 						dwDstLen += tsd_strlen(TSD_TEXT("　"));
 					} else {
@@ -264,7 +269,7 @@ const DWORD AribToStringInternal(TSDCHAR *lpszDst, const int dst_maxlen,
 			}
 		} else{
 			// エスケープシーケンス処理
-			ProcessEscapeSeq((BYTE)dwSrcData);
+			ProcessEscapeSeq(ctx, (BYTE)dwSrcData);
 		}
 
 		if (charlen > 0) {
@@ -285,7 +290,7 @@ const DWORD AribToStringInternal(TSDCHAR *lpszDst, const int dst_maxlen,
 	return dwDstLen;
 }
 
-const DWORD ProcessCharCode(TSDCHAR *lpszDst, const WORD wCode, const CODE_SET CodeSet)
+const DWORD ProcessCharCode(arib_decoder_t *ctx, TSDCHAR *lpszDst, const WORD wCode, const CODE_SET CodeSet)
 {
 	switch(CodeSet){
 	case CODE_KANJI	:
@@ -297,7 +302,7 @@ const DWORD ProcessCharCode(TSDCHAR *lpszDst, const WORD wCode, const CODE_SET C
 	case CODE_ALPHANUMERIC :
 	case CODE_PROP_ALPHANUMERIC :
 		// 英数字コード出力
-		if( IsSmallCharMode() == false ){
+		if( IsSmallCharMode(ctx) == false ){
 			//全角テーブルコード取得
 			return PutAlphanumericChar(lpszDst, wCode);
 		} else {
@@ -361,37 +366,37 @@ const DWORD PutKanjiChar(TSDCHAR *lpszDst, const WORD wCode)
 	return 1;
 }
 #else
-/* iconvで変換する */
+/* 変換表でUnicodeにしてUTF-8で出力する */
 const DWORD PutKanjiChar(TSDCHAR *lpszDst, const WORD wCode)
 {
-	char code[9];
-	iconv_t cd;
-
-	size_t inbyte = 8;
-	size_t outbyte = 8;
-  
-	const char *fptr;
-	char *tptr;
+	int row = ((wCode >> 8) & 0xFF) - 0x21;
+	int cell = (wCode & 0xFF) - 0x21;
+	unsigned int ucs;
 
-	code[0] = 0x1BU;
-	code[1] = 0x24U;
-	code[2] = 0x40U;
-	code[3] = wCode >> 8;
-	code[4] = wCode & 0xFF;
-	code[5] = 0x1BU;
-	code[6] = 0x28U;
-	code[7] = 0x4AU;
-	code[8] = '\0';
-
-	cd = iconv_open("UTF-8","ISO-2022-JP");
-
-	fptr = code;
-	tptr = lpszDst;
-	iconv(cd, (char **)&fptr, &inbyte, &tptr, &outbyte);
-
-	iconv_close(cd);
+	if (row < 0 || row >= 94 || cell < 0 || cell >= 94) {
+		return 0;
+	}
+	ucs = jisx0208_to_ucs[row][cell];
+	if (ucs == 0) {
+		/* 85区以降はARIBの追加記号 */
+		if (wCode >= 0x7521U) {
+			return PutSymbolsChar(lpszDst, wCode);
+		}
+		return 0;
+	}
 
-	return 8-outbyte;
+	if (ucs < 0x80) {
+		lpszDst[0] = (TSDCHAR)ucs;
+		return 1;
+	} else if (ucs < 0x800) {
+		lpszDst[0] = (TSDCHAR)(0xC0 | (ucs >> 6));
+		lpszDst[1] = (TSDCHAR)(0x80 | (ucs & 0x3F));
+		return 2;
+	}
+	lpszDst[0] = (TSDCHAR)(0xE0 | (ucs >> 12));
+	lpszDst[1] = (TSDCHAR)(0x80 | ((ucs >> 6) & 0x3F));
+	lpszDst[2] = (TSDCHAR)(0x80 | (ucs & 0x3F));
+	return 3;
 }
 #endif
 
@@ -615,148 +620,148 @@ const DWORD PutSymbolsChar(TSDCHAR *lpszDst, const WORD wCode)
 	return tsd_strlen(lpszDst);
 }
 
-void ProcessEscapeSeq(const BYTE byCode)
+void ProcessEscapeSeq(arib_decoder_t *ctx, const BYTE byCode)
 {
 	// エスケープシーケンス処理
-	switch(m_byEscSeqCount){
+	switch(ctx->m_byEscSeqCount){
 		// 1バイト目
 	case 1U	:
 		switch(byCode){
 			// Invocation of code elements
-		case 0x6EU	: LockingShiftGL(2U);	m_byEscSeqCount = 0U;	return;		// LS2
-		case 0x6FU	: LockingShiftGL(3U);	m_byEscSeqCount = 0U;	return;		// LS3
-		case 0x7EU	: LockingShiftGR(1U);	m_byEscSeqCount = 0U;	return;		// LS1R
-		case 0x7DU	: LockingShiftGR(2U);	m_byEscSeqCount = 0U;	return;		// LS2R
-		case 0x7CU	: LockingShiftGR(3U);	m_byEscSeqCount = 0U;	return;		// LS3R
+		case 0x6EU	: LockingShiftGL(ctx, 2U);	ctx->m_byEscSeqCount = 0U;	return;		// LS2
+		case 0x6FU	: LockingShiftGL(ctx, 3U);	ctx->m_byEscSeqCount = 0U;	return;		// LS3
+		case 0x7EU	: LockingShiftGR(ctx, 1U);	ctx->m_byEscSeqCount = 0U;	return;		// LS1R
+		case 0x7DU	: LockingShiftGR(ctx, 2U);	ctx->m_byEscSeqCount = 0U;	return;		// LS2R
+		case 0x7CU	: LockingShiftGR(ctx, 3U);	ctx->m_byEscSeqCount = 0U;	return;		// LS3R
 
 			// Designation of graphic sets
 		case 0x24U	:	
-		case 0x28U	: m_byEscSeqIndex = 0U;		break;
-		case 0x29U	: m_byEscSeqIndex = 1U;		break;
-		case 0x2AU	: m_byEscSeqIndex = 2U;		break;
-		case 0x2BU	: m_byEscSeqIndex = 3U;		break;
-		default		: m_byEscSeqCount = 0U;		return;		// エラー
+		case 0x28U	: ctx->m_byEscSeqIndex = 0U;		break;
+		case 0x29U	: ctx->m_byEscSeqIndex = 1U;		break;
+		case 0x2AU	: ctx->m_byEscSeqIndex = 2U;		break;
+		case 0x2BU	: ctx->m_byEscSeqIndex = 3U;		break;
+		default		: ctx->m_byEscSeqCount = 0U;		return;		// エラー
 		}
 		break;
 
 		// 2バイト目
 	case 2U	:
-		if(DesignationGSET(m_byEscSeqIndex, byCode)){
-			m_byEscSeqCount = 0U;
+		if(DesignationGSET(ctx, ctx->m_byEscSeqIndex, byCode)){
+			ctx->m_byEscSeqCount = 0U;
 			return;
 		}
 			
 		switch(byCode){
-		case 0x20	: m_bIsEscSeqDrcs = true;	break;
-		case 0x28	: m_bIsEscSeqDrcs = true;	m_byEscSeqIndex = 0U;	break;
-		case 0x29	: m_bIsEscSeqDrcs = false;	m_byEscSeqIndex = 1U;	break;
-		case 0x2A	: m_bIsEscSeqDrcs = false;	m_byEscSeqIndex = 2U;	break;
-		case 0x2B	: m_bIsEscSeqDrcs = false;	m_byEscSeqIndex = 3U;	break;
-		default		: m_byEscSeqCount = 0U;		return;		// エラー
+		case 0x20	: ctx->m_bIsEscSeqDrcs = true;	break;
+		case 0x28	: ctx->m_bIsEscSeqDrcs = true;	ctx->m_byEscSeqIndex = 0U;	break;
+		case 0x29	: ctx->m_bIsEscSeqDrcs = false;	ctx->m_byEscSeqIndex = 1U;	break;
+		case 0x2A	: ctx->m_bIsEscSeqDrcs = false;	ctx->m_byEscSeqIndex = 2U;	break;
+		case 0x2B	: ctx->m_bIsEscSeqDrcs = false;	ctx->m_byEscSeqIndex = 3U;	break;
+		default		: ctx->m_byEscSeqCount = 0U;		return;		// エラー
 		}
 		break;
 
 		// 3バイト目
 	case 3U	:
-		if(!m_bIsEscSeqDrcs){
-			if(DesignationGSET(m_byEscSeqIndex, byCode)){
-				m_byEscSeqCount = 0U;
+		if(!ctx->m_bIsEscSeqDrcs){
+			if(DesignationGSET(ctx, ctx->m_byEscSeqIndex, byCode)){
+				ctx->m_byEscSeqCount = 0U;
 				return;
 			}
 		}
 		else{
-			if(DesignationDRCS(m_byEscSeqIndex, byCode)){
-				m_byEscSeqCount = 0U;
+			if(DesignationDRCS(ctx, ctx->m_byEscSeqIndex, byCode)){
+				ctx->m_byEscSeqCount = 0U;
 				return;
 			}
 		}
 
 		if(byCode == 0x20U){
-			m_bIsEscSeqDrcs = true;
+			ctx->m_bIsEscSeqDrcs = true;
 		}
 		else{
 			// エラー
-			m_byEscSeqCount = 0U;
+			ctx->m_byEscSeqCount = 0U;
 			return;
 		}
 		break;
 
 		// 4バイト目
 	case 4U	:
-		DesignationDRCS(m_byEscSeqIndex, byCode);
-		m_byEscSeqCount = 0U;
+		DesignationDRCS(ctx, ctx->m_byEscSeqIndex, byCode);
+		ctx->m_byEscSeqCount = 0U;
 		return;
 	}
 
-	m_byEscSeqCount++;
+	ctx->m_byEscSeqCount++;
 }
 
-void LockingShiftGL(const BYTE byIndexG)
+void LockingShiftGL(arib_decoder_t *ctx, const BYTE byIndexG)
 {
 	// LSx
-	m_pLockingGL = &m_CodeG[(int)byIndexG];
+	ctx->m_pLockingGL = &ctx->m_CodeG[(int)byIndexG];
 }
 
-void LockingShiftGR(const BYTE byIndexG)
+void LockingShiftGR(arib_decoder_t *ctx, const BYTE byIndexG)
 {
 	// LSxR
-	m_pLockingGR = &m_CodeG[(int)byIndexG];
+	ctx->m_pLockingGR = &ctx->m_CodeG[(int)byIndexG];
 }
 
-void SingleShiftGL(const BYTE byIndexG)
+void SingleShiftGL(arib_decoder_t *ctx, const BYTE byIndexG)
 {
 	// SSx
-	m_pSingleGL  = &m_CodeG[(int)byIndexG];
+	ctx->m_pSingleGL  = &ctx->m_CodeG[(int)byIndexG];
 }
 
-const bool DesignationGSET(const BYTE byIndexG_arg, const BYTE byCode)
+const bool DesignationGSET(arib_decoder_t *ctx, const BYTE byIndexG_arg, const BYTE byCode)
 {
 	int byIndexG = (int)byIndexG_arg;
 
 	// Gのグラフィックセットを割り当てる
 	switch(byCode){
-	case 0x42U	: m_CodeG[byIndexG] = CODE_KANJI;				return true;	// Kanji
-	case 0x4AU	: m_CodeG[byIndexG] = CODE_ALPHANUMERIC;		return true;	// Alphanumeric
-	case 0x30U	: m_CodeG[byIndexG] = CODE_HIRAGANA;			return true;	// Hiragana
-	case 0x31U	: m_CodeG[byIndexG] = CODE_KATAKANA;			return true;	// Katakana
-	case 0x32U	: m_CodeG[byIndexG] = CODE_MOSAIC_A;			return true;	// Mosaic A
-	case 0x33U	: m_CodeG[byIndexG] = CODE_MOSAIC_B;			return true;	// Mosaic B
-	case 0x34U	: m_CodeG[byIndexG] = CODE_MOSAIC_C;			return true;	// Mosaic C
-	case 0x35U	: m_CodeG[byIndexG] = CODE_MOSAIC_D;			return true;	// Mosaic D
-	case 0x36U	: m_CodeG[byIndexG] = CODE_PROP_ALPHANUMERIC;	return true;	// Proportional Alphanumeric
-	case 0x37U	: m_CodeG[byIndexG] = CODE_PROP_HIRAGANA;		return true;	// Proportional Hiragana
-	case 0x38U	: m_CodeG[byIndexG] = CODE_PROP_KATAKANA;		return true;	// Proportional Katakana
-	case 0x49U	: m_CodeG[byIndexG] = CODE_JIS_X0201_KATAKANA;	return true;	// JIS X 0201 Katakana
-	case 0x39U	: m_CodeG[byIndexG] = CODE_JIS_KANJI_PLANE_1;	return true;	// JIS compatible Kanji Plane 1
-	case 0x3AU	: m_CodeG[byIndexG] = CODE_JIS_KANJI_PLANE_2;	return true;	// JIS compatible Kanji Plane 2
-	case 0x3BU	: m_CodeG[byIndexG] = CODE_ADDITIONAL_SYMBOLS;	return true;	// Additional symbols
+	case 0x42U	: ctx->m_CodeG[byIndexG] = CODE_KANJI;				return true;	// Kanji
+	case 0x4AU	: ctx->m_CodeG[byIndexG] = CODE_ALPHANUMERIC;		return true;	// Alphanumeric
+	case 0x30U	: ctx->m_CodeG[byIndexG] = CODE_HIRAGANA;			return true;	// Hiragana
+	case 0x31U	: ctx->m_CodeG[byIndexG] = CODE_KATAKANA;			return true;	// Katakana
+	case 0x32U	: ctx->m_CodeG[byIndexG] = CODE_MOSAIC_A;			return true;	// Mosaic A
+	case 0x33U	: ctx->m_CodeG[byIndexG] = CODE_MOSAIC_B;			return true;	// Mosaic B
+	case 0x34U	: ctx->m_CodeG[byIndexG] = CODE_MOSAIC_C;			return true;	// Mosaic C
+	case 0x35U	: ctx->m_CodeG[byIndexG] = CODE_MOSAIC_D;			return true;	// Mosaic D
+	case 0x36U	: ctx->m_CodeG[byIndexG] = CODE_PROP_ALPHANUMERIC;	return true;	// Proportional Alphanumeric
+	case 0x37U	: ctx->m_CodeG[byIndexG] = CODE_PROP_HIRAGANA;		return true;	// Proportional Hiragana
+	case 0x38U	: ctx->m_CodeG[byIndexG] = CODE_PROP_KATAKANA;		return true;	// Proportional Katakana
+	case 0x49U	: ctx->m_CodeG[byIndexG] = CODE_JIS_X0201_KATAKANA;	return true;	// JIS X 0201 Katakana
+	case 0x39U	: ctx->m_CodeG[byIndexG] = CODE_JIS_KANJI_PLANE_1;	return true;	// JIS compatible Kanji Plane 1
+	case 0x3AU	: ctx->m_CodeG[byIndexG] = CODE_JIS_KANJI_PLANE_2;	return true;	// JIS compatible Kanji Plane 2
+	case 0x3BU	: ctx->m_CodeG[byIndexG] = CODE_ADDITIONAL_SYMBOLS;	return true;	// Additional symbols
 	default		: return false;		// 不明なグラフィックセット
 	}
 }
 
-const bool DesignationDRCS(const BYTE byIndexG_arg, const BYTE byCode)
+const bool DesignationDRCS(arib_decoder_t *ctx, const BYTE byIndexG_arg, const BYTE byCode)
 {
 	int byIndexG = (int)byIndexG_arg;
 
 	// DRCSのグラフィックセットを割り当てる
 	switch(byCode){
-	case 0x40U	: m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// DRCS-0
-	case 0x41U	: m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// DRCS-1
-	case 0x42U	: m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// DRCS-2
-	case 0x43U	: m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// DRCS-3
-	case 0x44U	: m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// DRCS-4
-	case 0x45U	: m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// DRCS-5
-	case 0x46U	: m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// DRCS-6
-	case 0x47U	: m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// DRCS-7
-	case 0x48U	: m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// DRCS-8
-	case 0x49U	: m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// DRCS-9
-	case 0x4AU	: m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// DRCS-10
-	case 0x4BU	: m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// DRCS-11
-	case 0x4CU	: m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// DRCS-12
-	case 0x4DU	: m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// DRCS-13
-	case 0x4EU	: m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// DRCS-14
-	case 0x4FU	: m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// DRCS-15
-	case 0x70U	: m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// Macro
+	case 0x40U	: ctx->m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// DRCS-0
+	case 0x41U	: ctx->m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// DRCS-1
+	case 0x42U	: ctx->m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// DRCS-2
+	case 0x43U	: ctx->m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// DRCS-3
+	case 0x44U	: ctx->m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// DRCS-4
+	case 0x45U	: ctx->m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// DRCS-5
+	case 0x46U	: ctx->m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// DRCS-6
+	case 0x47U	: ctx->m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// DRCS-7
+	case 0x48U	: ctx->m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// DRCS-8
+	case 0x49U	: ctx->m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// DRCS-9
+	case 0x4AU	: ctx->m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// DRCS-10
+	case 0x4BU	: ctx->m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// DRCS-11
+	case 0x4CU	: ctx->m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// DRCS-12
+	case 0x4DU	: ctx->m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// DRCS-13
+	case 0x4EU	: ctx->m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// DRCS-14
+	case 0x4FU	: ctx->m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// DRCS-15
+	case 0x70U	: ctx->m_CodeG[byIndexG] = CODE_UNKNOWN;				return true;	// Macro
 	default		: return false;		// 不明なグラフィックセット
 }
 }
@@ -0,0 +1,134 @@
+#include "core/tsdump_def.h"
+
+#ifdef TSD_PLATFORM_MSVC
+#include <Windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TSD_CRC_PCLMUL
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <wmmintrin.h>
+#endif
+
+#ifdef TSD_PLATFORM_MSVC
+#include <intrin.h>
+#define TSD_CRC_PCLMUL_FUNC
+#else
+#define TSD_CRC_PCLMUL_FUNC		__attribute__((target("pclmul,ssse3")))
+#endif
+
+#include "utils/tsdthread.h"
+#include "utils/tsdcrc.h"
+#include "utils/tsdcrc_table.h"
+
+/* CRC-32/MPEG-2 ( 0x04C11DB7Al 0xFFFFFFFFArbg]Ȃ) */
+
+#ifdef TSD_CRC_PCLMUL
+/* 0: mF, 1: gȂ, 2: g */
+static int pclmul_state = 0;
+
+static int use_pclmul()
+{
+	int state = tsd_atomic_load(&pclmul_state);
+
+	if (state == 0) {
+#ifdef TSD_PLATFORM_MSVC
+		int info[4];
+		__cpuid(info, 1);
+		state = ((info[2] & (1 << 1)) && (info[2] & (1 << 9))) ? 2 : 1;
+#else
+		__builtin_cpu_init();
+		state = (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3")) ? 2 : 1;
+#endif
+		tsd_atomic_store(&pclmul_state, state);
+	}
+	return state == 2;
+}
+#endif
+
+/* slice-by-8 */
+static uint32_t crc32_sb8(uint32_t crc, const uint8_t *buf, int len)
+{
+	uint32_t w;
+
+	for (; len >= 8; len -= 8, buf += 8) {
+		w = crc ^ ((uint32_t)buf[0] << 24 | (uint32_t)buf[1] << 16 | (uint32_t)buf[2] << 8 | buf[3]);
+		crc = crc_table[7][w >> 24] ^ crc_table[6][(w >> 16) & 0xff] ^
+			crc_table[5][(w >> 8) & 0xff] ^ crc_table[4][w & 0xff] ^
+			crc_table[3][buf[4]] ^ crc_table[2][buf[5]] ^
+			crc_table[1][buf[6]] ^ crc_table[0][buf[7]];
+	}
+	for (; len > 0; len--, buf++) {
+		crc = (crc << 8) ^ crc_table[0][(crc >> 24) ^ *buf];
+	}
+	return crc;
+}
+
+#ifdef TSD_CRC_PCLMUL
+
+/*
+	oCg𔽓]Đ擪oCgMSBbit127ƂǍWƂĂ̂܂܈B
+	X*x^n = H*x^(n+64) + L*x^n  H*(x^(n+64) mod P) + L*(x^n mod P) ŏݍłA
+	ŌɎc128bitƒ[e[uŏ
+*/
+
+static inline TSD_CRC_PCLMUL_FUNC __m128i fold(__m128i x, __m128i k)
+{
+	return _mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x11), _mm_clmulepi64_si128(x, k, 0x00));
+}
+
+static TSD_CRC_PCLMUL_FUNC uint32_t crc32_pclmul(const uint8_t *buf, int len)
+{
+	int i;
+	uint8_t tmp[16];
+	const __m128i bswap = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+	const __m128i k128 = _mm_set_epi64x(K_FOLD128_HI, K_FOLD128_LO);
+	const __m128i k512 = _mm_set_epi64x(K_FOLD512_HI, K_FOLD512_LO);
+	__m128i x[4];
+
+	/* l0xFFFFFFFF͐擪4oCg̔]Ɠ */
+	for (i = 0; i < 4; i++) {
+		x[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&buf[i * 16]), bswap);
+	}
+	x[0] = _mm_xor_si128(x[0], _mm_set_epi32(-1, 0, 0, 0));
+	buf += 64;
+	len -= 64;
+
+	for (; len >= 64; len -= 64, buf += 64) {
+		for (i = 0; i < 4; i++) {
+			x[i] = _mm_xor_si128(fold(x[i], k512),
+				_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&buf[i * 16]), bswap));
+		}
+	}
+
+	x[0] = _mm_xor_si128(fold(x[0], k128), x[1]);
+	x[0] = _mm_xor_si128(fold(x[0], k128), x[2]);
+	x[0] = _mm_xor_si128(fold(x[0], k128), x[3]);
+	for (; len >= 16; len -= 16, buf += 16) {
+		x[0] = _mm_xor_si128(fold(x[0], k128),
+			_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)buf), bswap));
+	}
+
+	_mm_storeu_si128((__m128i*)tmp, _mm_shuffle_epi8(x[0], bswap));
+	return crc32_sb8(crc32_sb8(0, tmp, 16), buf, len);
+}
+
+#endif
+
+uint32_t tsd_crc32(const uint8_t *buf, int len)
+{
+#ifdef TSD_CRC_PCLMUL
+	if (len >= 64 && use_pclmul()) {
+		return crc32_pclmul(buf, len);
+	}
+#endif
+	return crc32_sb8(0xffffffff, buf, len);
+}
@@ -0,0 +1 @@
+uint32_t tsd_crc32(const uint8_t *buf, int len);
@@ -0,0 +1,133 @@
+#include "core/tsdump_def.h"
+
+#ifdef TSD_PLATFORM_MSVC
+#include <Windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "utils/tsdthread.h"
+
+typedef struct {
+	tsd_thread_func_t func;
+	void *param;
+} thread_start_t;
+
+#ifdef TSD_PLATFORM_MSVC
+static unsigned __stdcall thread_start(void *p)
+#else
+static void *thread_start(void *p)
+#endif
+{
+	thread_start_t start = *(thread_start_t*)p;
+	free(p);
+	start.func(start.param);
+	return 0;
+}
+
+/* 1Ԃ */
+int tsd_thread_create(tsd_thread_t *thread, tsd_thread_func_t func, void *param)
+{
+	thread_start_t *start = (thread_start_t*)malloc(sizeof(thread_start_t));
+	start->func = func;
+	start->param = param;
+#ifdef TSD_PLATFORM_MSVC
+	*thread = (HANDLE)_beginthreadex(NULL, 0, thread_start, start, 0, NULL);
+	if (*thread == 0) {
+		free(start);
+		return 0;
+	}
+#else
+	if (pthread_create(thread, NULL, thread_start, start) != 0) {
+		free(start);
+		return 0;
+	}
+#endif
+	return 1;
+}
+
+void tsd_thread_join(tsd_thread_t thread)
+{
+#ifdef TSD_PLATFORM_MSVC
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+#else
+	pthread_join(thread, NULL);
+#endif
+}
+
+void tsd_mutex_init(tsd_mutex_t *mutex)
+{
+#ifdef TSD_PLATFORM_MSVC
+	InitializeCriticalSection(mutex);
+#else
+	pthread_mutex_init(mutex, NULL);
+#endif
+}
+
+void tsd_mutex_destroy(tsd_mutex_t *mutex)
+{
+#ifdef TSD_PLATFORM_MSVC
+	DeleteCriticalSection(mutex);
+#else
+	pthread_mutex_destroy(mutex);
+#endif
+}
+
+void tsd_mutex_lock(tsd_mutex_t *mutex)
+{
+#ifdef TSD_PLATFORM_MSVC
+	EnterCriticalSection(mutex);
+#else
+	pthread_mutex_lock(mutex);
+#endif
+}
+
+void tsd_mutex_unlock(tsd_mutex_t *mutex)
+{
+#ifdef TSD_PLATFORM_MSVC
+	LeaveCriticalSection(mutex);
+#else
+	pthread_mutex_unlock(mutex);
+#endif
+}
+
+void tsd_cond_init(tsd_cond_t *cond)
+{
+#ifdef TSD_PLATFORM_MSVC
+	InitializeConditionVariable(cond);
+#else
+	pthread_cond_init(cond, NULL);
+#endif
+}
+
+void tsd_cond_destroy(tsd_cond_t *cond)
+{
+#ifdef TSD_PLATFORM_MSVC
+	UNREF_ARG(cond);
+#else
+	pthread_cond_destroy(cond);
+#endif
+}
+
+void tsd_cond_wait(tsd_cond_t *cond, tsd_mutex_t *mutex)
+{
+#ifdef TSD_PLATFORM_MSVC
+	SleepConditionVariableCS(cond, mutex, INFINITE);
+#else
+	pthread_cond_wait(cond, mutex);
+#endif
+}
+
+void tsd_cond_broadcast(tsd_cond_t *cond)
+{
+#ifdef TSD_PLATFORM_MSVC
+	WakeAllConditionVariable(cond);
+#else
+	pthread_cond_broadcast(cond);
+#endif
+}
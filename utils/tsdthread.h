@@ -0,0 +1,30 @@
+#ifdef TSD_PLATFORM_MSVC
+	typedef HANDLE								tsd_thread_t;
+	typedef CRITICAL_SECTION					tsd_mutex_t;
+	typedef CONDITION_VARIABLE					tsd_cond_t;
+
+	#define tsd_atomic_load(p)					InterlockedCompareExchange((volatile LONG*)(p), 0, 0)
+	#define tsd_atomic_store(p, v)				InterlockedExchange((volatile LONG*)(p), (LONG)(v))
+#else
+	typedef pthread_t							tsd_thread_t;
+	typedef pthread_mutex_t						tsd_mutex_t;
+	typedef pthread_cond_t						tsd_cond_t;
+
+	#define tsd_atomic_load(p)					__atomic_load_n((p), __ATOMIC_SEQ_CST)
+	#define tsd_atomic_store(p, v)				__atomic_store_n((p), (v), __ATOMIC_SEQ_CST)
+#endif
+
+typedef void (*tsd_thread_func_t)(void*);
+
+int tsd_thread_create(tsd_thread_t *thread, tsd_thread_func_t func, void *param);
+void tsd_thread_join(tsd_thread_t thread);
+
+void tsd_mutex_init(tsd_mutex_t *mutex);
+void tsd_mutex_destroy(tsd_mutex_t *mutex);
+void tsd_mutex_lock(tsd_mutex_t *mutex);
+void tsd_mutex_unlock(tsd_mutex_t *mutex);
+
+void tsd_cond_init(tsd_cond_t *cond);
+void tsd_cond_destroy(tsd_cond_t *cond);
+void tsd_cond_wait(tsd_cond_t *cond, tsd_mutex_t *mutex);
+void tsd_cond_broadcast(tsd_cond_t *cond);